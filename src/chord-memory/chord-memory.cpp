@@ -94,6 +94,9 @@ bool ConduitChordMemory::notePortsInfo(uint32_t index, bool isInput,
 
 clap_process_status ConduitChordMemory::process(const clap_process *process) noexcept
 {
+    shared::rtcheck::AudioThreadScope rtScope;
+    PatchSwapScope patchSwap{*this, process};
+
     handleEventsFromUIQueue(process->out_events);
 
     auto ev = process->in_events;
@@ -210,17 +213,27 @@ bool ConduitChordMemory::updateNoteOnOffData(int16_t channel, int16_t key, bool
     return isOn ? an == 1 : an == 0;
 }
 
-bool ConduitChordMemoryConfig::PatchExtension::toXml(TiXmlElement &el)
+bool ConduitChordMemoryConfig::PatchExtension::toBinary(shared::StateWriter &w) const
+{
+    w.u32(companionNotes.size());
+    for (const auto &cn : companionNotes)
+        w.u64(cn.to_ullong());
+    return true;
+}
+
+bool ConduitChordMemoryConfig::PatchExtension::fromBinary(shared::StateReader &r)
 {
-    TiXmlElement cn("companionNotes");
-    for (auto i = 0U; i < companionNotes.size(); ++i)
+    uint32_t n;
+    if (!r.u32(n))
+        return false;
+    for (auto i = 0U; i < n; ++i)
     {
-        TiXmlElement nt("note");
-        nt.SetAttribute("n", i);
-        nt.SetAttribute("b", companionNotes[i].to_string());
-        cn.InsertEndChild(nt);
+        uint64_t bits;
+        if (!r.u64(bits))
+            return false;
+        if (i < companionNotes.size())
+            companionNotes[i] = std::bitset<49>(bits);
     }
-    el.InsertEndChild(cn);
     return true;
 }
 
@@ -49,7 +49,9 @@ struct ConduitChordMemoryConfig
 
         std::array<std::bitset<49>, 128> companionNotes; // the +24 and -24 notes generated by a key
 
-        bool toXml(TiXmlElement &);
+        bool toBinary(sst::conduit::shared::StateWriter &) const;
+        bool fromBinary(sst::conduit::shared::StateReader &);
+        // patches from before the binary state
         bool fromXml(TiXmlElement *);
     };
 
@@ -117,6 +117,9 @@ bool ConduitClapEventMonitor::notePortsInfo(uint32_t index, bool isInput,
 }
 clap_process_status ConduitClapEventMonitor::process(const clap_process *process) noexcept
 {
+    shared::rtcheck::AudioThreadScope rtScope;
+    PatchSwapScope patchSwap{*this, process};
+
     auto ev = process->in_events;
     auto ov = process->out_events;
     auto sz = ev->size(ev);
@@ -0,0 +1,804 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+/*
+ * conduit-bench is an offline host for the plugins in this repo. It goes in through
+ * clap_entry and the plugin factory exactly as a DAW would, feeds each plugin a
+ * scripted stream of notes, parameter changes, modulation and audio input, renders
+ * a fixed amount of audio as fast as it can, and reports
+ *
+ * - the real time factor (seconds of audio per second of wall clock)
+ * - percentiles of the time spent in a single process call
+ * - for instruments, the mean process call divided by the held voices, so the default
+ *   sweep of 8, 32 and 64 voices shows what each voice costs as the count grows
+ * - operator new calls made during process, per block, on any thread
+ *
+ * Plugins which offer the conduit render load extension also report their peak load
+ * and what they shed to stay within it (see conduit-shared/render-load.h).
+ *
+ * Runs can sweep held voice counts and polysynth render threads, and --min-rtf /
+ * --max-allocs turn the report into a pass/fail gate. --stress runs every plugin with
+ * dense random automation and fails on any allocation inside process; with
+ * CONDUIT_RT_CHECKS it also names the call sites (see conduit-shared/rt-check.h).
+ * Run with --help for the rest.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// clap/entry.h declares the clap_entry which conduit-clap-entry.cpp provides
+#include <clap/clap.h>
+
+#include "conduit-shared/render-load.h"
+#include "conduit-shared/rt-check.h"
+
+namespace sst::conduit::bench
+{
+namespace rtc = sst::conduit::shared::rtcheck;
+
+struct Options
+{
+    std::vector<std::string> plugins{"polysynth", "polymetric-delay", "ring-modulator"};
+    std::vector<int> voices{8, 32, 64};
+    std::vector<int> threads{0};
+    uint64_t seed{1};
+    double seconds{10.0};
+    double sampleRate{48000.0};
+    uint32_t blockSize{256};
+    double noteLength{0.5};
+    uint32_t paramInterval{512};
+    uint32_t modInterval{64};
+    double minRTF{0.0};
+    double maxAllocs{-1.0};
+    bool steppedParams{false};
+    bool csv{false};
+};
+
+struct Result
+{
+    std::string pluginId;
+    int voices{0}, threads{0};
+    double rtf{0};
+    double p50{0}, p90{0}, p99{0}, p999{0}, maxUs{0};
+    double usPerVoice{0};
+    double allocsPerBlock{0};
+    uint64_t maxAllocsInBlock{0}, blocksWhichAllocated{0};
+    uint64_t rtViolations{0};
+
+    bool hasRenderLoad{false};
+    double peakLoad{0};
+    uint32_t voicesShed{0}, minUnisonCap{0}, blocksOverLimit{0};
+};
+
+/*
+ * The host side of things. Restart and callback requests are honoured between
+ * blocks, as a real host would do them on the main thread.
+ */
+struct BenchHost
+{
+    clap_host host;
+    std::atomic<bool> restartRequested{false}, callbackRequested{false};
+
+    BenchHost()
+    {
+        host.clap_version = CLAP_VERSION;
+        host.host_data = this;
+        host.name = "conduit-bench";
+        host.vendor = "Surge Synth Team";
+        host.url = "https://github.com/surge-synthesizer/conduit";
+        host.version = "1.0";
+        host.get_extension = [](const clap_host *, const char *) -> const void * {
+            return nullptr;
+        };
+        host.request_restart = [](const clap_host *h) {
+            static_cast<BenchHost *>(h->host_data)->restartRequested = true;
+        };
+        host.request_process = [](const clap_host *) {};
+        host.request_callback = [](const clap_host *h) {
+            static_cast<BenchHost *>(h->host_data)->callbackRequested = true;
+        };
+    }
+};
+
+union BenchEvent
+{
+    clap_event_header_t header;
+    clap_event_note_t note;
+    clap_event_param_value_t param;
+    clap_event_param_mod_t mod;
+};
+
+struct EventList
+{
+    std::vector<BenchEvent> events;
+    clap_input_events_t in;
+    clap_output_events_t out;
+
+    EventList()
+    {
+        events.reserve(8192);
+        in.ctx = this;
+        in.size = [](const clap_input_events_t *l) {
+            return (uint32_t) static_cast<EventList *>(l->ctx)->events.size();
+        };
+        in.get = [](const clap_input_events_t *l, uint32_t i) {
+            return &static_cast<EventList *>(l->ctx)->events[i].header;
+        };
+        out.ctx = this;
+        out.try_push = [](const clap_output_events_t *, const clap_event_header_t *) {
+            return true;
+        };
+    }
+
+    void sortByTime()
+    {
+        std::stable_sort(events.begin(), events.end(), [](const auto &a, const auto &b) {
+            return a.header.time < b.header.time;
+        });
+    }
+};
+
+struct ParamTarget
+{
+    clap_id id;
+    double minV, maxV, defV;
+    bool stepped;
+};
+
+/*
+ * Each of the held voices is a slot with a fixed key and channel which retriggers every
+ * noteLength, with the slots staggered so note ons and offs are spread over time.
+ */
+struct NoteScript
+{
+    int voices{0};
+    int64_t noteSamples{1};
+
+    int keyFor(int slot) const { return 24 + slot % 84; }
+    int channelFor(int slot) const { return (slot / 84) % 16; }
+
+    void addEvents(EventList &el, int64_t blockStart, uint32_t blockSize) const
+    {
+        for (int s = 0; s < voices; ++s)
+        {
+            auto offset = noteSamples * s / voices;
+            auto first = std::max<int64_t>(0, blockStart - offset);
+            // each trigger point in [blockStart, blockStart + blockSize) for this slot
+            auto k = (first + noteSamples - 1) / noteSamples;
+            for (auto t = k * noteSamples + offset; t < blockStart + blockSize; t += noteSamples)
+            {
+                auto when = (uint32_t)(t - blockStart);
+                if (t >= noteSamples + offset)
+                    push(el, CLAP_EVENT_NOTE_OFF, s, when, 0.0);
+                push(el, CLAP_EVENT_NOTE_ON, s, when, 0.6 + 0.4 * ((s * 37) % 11) / 10.0);
+            }
+        }
+    }
+
+    void push(EventList &el, uint16_t type, int slot, uint32_t when, double velocity) const
+    {
+        BenchEvent e{};
+        e.note.header.size = sizeof(clap_event_note_t);
+        e.note.header.time = when;
+        e.note.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+        e.note.header.type = type;
+        e.note.note_id = slot;
+        e.note.port_index = 0;
+        e.note.channel = (int16_t)channelFor(slot);
+        e.note.key = (int16_t)keyFor(slot);
+        e.note.velocity = velocity;
+        el.events.push_back(e);
+    }
+};
+
+struct AudioBuffers
+{
+    std::vector<std::vector<float>> storage;
+    std::vector<std::vector<float *>> ptrs;
+    std::vector<clap_audio_buffer_t> buffers;
+
+    void setup(const clap_plugin_t *plugin, const clap_plugin_audio_ports_t *ports, bool isInput,
+               uint32_t blockSize)
+    {
+        auto n = ports ? ports->count(plugin, isInput) : 0;
+        storage.clear();
+        ptrs.resize(n);
+        buffers.resize(n);
+        for (uint32_t p = 0; p < n; ++p)
+        {
+            clap_audio_port_info_t info;
+            ports->get(plugin, p, isInput, &info);
+            ptrs[p].clear();
+            for (uint32_t c = 0; c < info.channel_count; ++c)
+            {
+                storage.emplace_back(blockSize, 0.f);
+                ptrs[p].push_back(nullptr);
+            }
+        }
+        size_t si{0};
+        for (uint32_t p = 0; p < n; ++p)
+        {
+            for (auto &c : ptrs[p])
+                c = storage[si++].data();
+            buffers[p].data32 = ptrs[p].data();
+            buffers[p].data64 = nullptr;
+            buffers[p].channel_count = (uint32_t)ptrs[p].size();
+            buffers[p].latency = 0;
+            buffers[p].constant_mask = 0;
+        }
+    }
+
+    // A different sine in each channel with a little noise, so effects have something to chew
+    void fillInput(int64_t blockStart, uint32_t blockSize, double sampleRate, uint32_t &rng)
+    {
+        static constexpr double twoPi{2.0 * 3.14159265358979323846};
+        int ch{0};
+        for (auto &c : storage)
+        {
+            auto w = twoPi * 110.0 * (ch + 1) / sampleRate;
+            for (uint32_t i = 0; i < blockSize; ++i)
+            {
+                rng = rng * 1664525U + 1013904223U;
+                auto noise = (float)(rng >> 8) / (float)(1 << 24) - 0.5f;
+                c[i] = 0.4f * (float)std::sin(w * (blockStart + i)) + 0.05f * noise;
+            }
+            ch++;
+        }
+    }
+};
+
+static double percentile(std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+        return 0;
+    auto idx = (size_t)std::min<double>(sorted.size() - 1, std::floor(p * sorted.size()));
+    return sorted[idx];
+}
+
+static bool runOne(const clap_plugin_factory_t *factory, const clap_plugin_descriptor_t *desc,
+                   const Options &opt, int voices, int threads, Result &res)
+{
+    BenchHost bh;
+    auto plugin = factory->create_plugin(factory, &bh.host, desc->id);
+    if (!plugin || !plugin->init(plugin))
+    {
+        std::cerr << "conduit-bench: unable to create " << desc->id << std::endl;
+        return false;
+    }
+
+    auto audioPorts =
+        static_cast<const clap_plugin_audio_ports_t *>(plugin->get_extension(plugin,
+                                                                             CLAP_EXT_AUDIO_PORTS));
+    auto notePorts =
+        static_cast<const clap_plugin_note_ports_t *>(plugin->get_extension(plugin,
+                                                                            CLAP_EXT_NOTE_PORTS));
+    auto params =
+        static_cast<const clap_plugin_params_t *>(plugin->get_extension(plugin, CLAP_EXT_PARAMS));
+    auto renderLoad = static_cast<const conduit_plugin_render_load_t *>(
+        plugin->get_extension(plugin, CONDUIT_EXT_RENDER_LOAD));
+
+    std::vector<ParamTarget> valueTargets, modTargets;
+    std::optional<clap_param_info_t> polyphonyParam, threadsParam, seedParam;
+    auto nParams = params ? params->count(plugin) : 0;
+    for (uint32_t i = 0; i < nParams; ++i)
+    {
+        clap_param_info_t info;
+        if (!params->get_info(plugin, i, &info))
+            continue;
+        if (info.flags & CLAP_PARAM_IS_READONLY)
+            continue;
+        // held at the run's settings below rather than swept
+        if (!strcmp(info.name, "Polyphony"))
+        {
+            polyphonyParam = info;
+            continue;
+        }
+        if (!strcmp(info.name, "Render Threads"))
+        {
+            threadsParam = info;
+            continue;
+        }
+        if (!strcmp(info.name, "Random Seed"))
+        {
+            seedParam = info;
+            continue;
+        }
+        // stepped params swap whole algorithms, which is a stress test rather than a benchmark
+        auto stepped = (info.flags & CLAP_PARAM_IS_STEPPED) != 0;
+        if (stepped && !opt.steppedParams)
+            continue;
+        auto t = ParamTarget{info.id, info.min_value, info.max_value, info.default_value, stepped};
+        if (info.flags & CLAP_PARAM_IS_AUTOMATABLE)
+            valueTargets.push_back(t);
+        if (info.flags & CLAP_PARAM_IS_MODULATABLE)
+            modTargets.push_back(t);
+    }
+
+    NoteScript notes;
+    notes.voices = (notePorts && notePorts->count(plugin, true) > 0) ? voices : 0;
+    notes.noteSamples = std::max<int64_t>(1, (int64_t)(opt.noteLength * opt.sampleRate));
+
+    // The run's settings go in with one flush before activate, which takes them up
+    EventList setup;
+    auto setParam = [&setup](const clap_param_info_t &info, double value) {
+        BenchEvent e{};
+        e.param.header.size = sizeof(clap_event_param_value_t);
+        e.param.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+        e.param.header.type = CLAP_EVENT_PARAM_VALUE;
+        e.param.param_id = info.id;
+        e.param.note_id = -1;
+        e.param.port_index = -1;
+        e.param.channel = -1;
+        e.param.key = -1;
+        e.param.value = std::clamp(value, info.min_value, info.max_value);
+        setup.events.push_back(e);
+    };
+
+    // Raise the polyphony to the voices we hold, or the voice manager steals the rest
+    double polyphony;
+    if (polyphonyParam && notes.voices > 0 &&
+        params->get_value(plugin, polyphonyParam->id, &polyphony) && polyphony < notes.voices)
+        setParam(*polyphonyParam, notes.voices);
+    // 0 asks for the default of one thread
+    if (threadsParam)
+        setParam(*threadsParam, std::max(threads, 1));
+    // Every instance plays the same noise, so runs compare
+    if (seedParam)
+        setParam(*seedParam, (double)opt.seed);
+    if (!setup.events.empty())
+        params->flush(plugin, &setup.in, &setup.out);
+
+    AudioBuffers ins, outs;
+    ins.setup(plugin, audioPorts, true, opt.blockSize);
+    outs.setup(plugin, audioPorts, false, opt.blockSize);
+
+    EventList events;
+    clap_event_transport_t transport{};
+    transport.header.size = sizeof(transport);
+    transport.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+    transport.header.type = CLAP_EVENT_TRANSPORT;
+    transport.flags = CLAP_TRANSPORT_HAS_TEMPO | CLAP_TRANSPORT_HAS_BEATS_TIMELINE |
+                      CLAP_TRANSPORT_HAS_TIME_SIGNATURE | CLAP_TRANSPORT_IS_PLAYING;
+    transport.tempo = 120;
+    transport.tsig_num = 4;
+    transport.tsig_denom = 4;
+
+    clap_process_t process{};
+    process.frames_count = opt.blockSize;
+    process.steady_time = 0;
+    process.transport = &transport;
+    process.audio_inputs = ins.buffers.data();
+    process.audio_inputs_count = (uint32_t)ins.buffers.size();
+    process.audio_outputs = outs.buffers.data();
+    process.audio_outputs_count = (uint32_t)outs.buffers.size();
+    process.in_events = &events.in;
+    process.out_events = &events.out;
+
+    auto start = [&]() {
+        plugin->activate(plugin, opt.sampleRate, opt.blockSize, opt.blockSize);
+        plugin->start_processing(plugin);
+    };
+    auto stop = [&]() {
+        plugin->stop_processing(plugin);
+        plugin->deactivate(plugin);
+    };
+    start();
+
+    auto nBlocks = (int64_t)std::ceil(opt.seconds * opt.sampleRate / opt.blockSize);
+    std::vector<double> blockUs;
+    std::vector<uint64_t> blockAllocs;
+    blockUs.reserve(nBlocks);
+    blockAllocs.reserve(nBlocks);
+
+    uint32_t rng{22222};
+    auto violationsAtStart = rtc::violationCount();
+    size_t nextValueTarget{0}, nextModTarget{0};
+    double wallSeconds{0};
+
+    for (int64_t b = 0; b < nBlocks; ++b)
+    {
+        auto blockStart = b * (int64_t)opt.blockSize;
+
+        if (bh.restartRequested.exchange(false))
+        {
+            stop();
+            start();
+        }
+        if (bh.callbackRequested.exchange(false))
+            plugin->on_main_thread(plugin);
+
+        events.events.clear();
+        notes.addEvents(events, blockStart, opt.blockSize);
+
+        // Wiggle the continuous params a few percent around their defaults
+        for (uint32_t t = 0; !valueTargets.empty() && t < opt.blockSize; ++t)
+        {
+            if ((blockStart + t) % opt.paramInterval != 0)
+                continue;
+            auto &pt = valueTargets[nextValueTarget++ % valueTargets.size()];
+            BenchEvent e{};
+            e.param.header.size = sizeof(clap_event_param_value_t);
+            e.param.header.time = t;
+            e.param.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+            e.param.header.type = CLAP_EVENT_PARAM_VALUE;
+            e.param.param_id = pt.id;
+            e.param.note_id = -1;
+            e.param.port_index = -1;
+            e.param.channel = -1;
+            e.param.key = -1;
+            if (pt.stepped)
+            {
+                rng = rng * 1664525U + 1013904223U;
+                e.param.value = pt.minV + (rng >> 8) % (uint32_t)(pt.maxV - pt.minV + 1);
+            }
+            else
+            {
+                auto v =
+                    pt.defV + 0.05 * (pt.maxV - pt.minV) * std::sin(0.001 * (blockStart + t));
+                e.param.value = std::clamp(v, pt.minV, pt.maxV);
+            }
+            events.events.push_back(e);
+        }
+        for (uint32_t t = 0; !modTargets.empty() && t < opt.blockSize; ++t)
+        {
+            if ((blockStart + t) % opt.modInterval != 0)
+                continue;
+            auto &pt = modTargets[nextModTarget++ % modTargets.size()];
+            BenchEvent e{};
+            e.mod.header.size = sizeof(clap_event_param_mod_t);
+            e.mod.header.time = t;
+            e.mod.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+            e.mod.header.type = CLAP_EVENT_PARAM_MOD;
+            e.mod.param_id = pt.id;
+            e.mod.note_id = -1;
+            e.mod.port_index = -1;
+            e.mod.channel = -1;
+            e.mod.key = -1;
+            e.mod.amount = 0.1 * (pt.maxV - pt.minV) * std::sin(0.0003 * (blockStart + t));
+            events.events.push_back(e);
+        }
+        events.sortByTime();
+
+        ins.fillInput(blockStart, opt.blockSize, opt.sampleRate, rng);
+
+        auto secs = blockStart / opt.sampleRate;
+        transport.song_pos_seconds = (clap_sectime)std::llround(secs * CLAP_SECTIME_FACTOR);
+        transport.song_pos_beats =
+            (clap_beattime)std::llround(secs * transport.tempo / 60.0 * CLAP_BEATTIME_FACTOR);
+        process.steady_time = blockStart;
+
+        auto a0 = rtc::allocationCount();
+        auto t0 = std::chrono::high_resolution_clock::now();
+        plugin->process(plugin, &process);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        auto a1 = rtc::allocationCount();
+
+        auto us = std::chrono::duration<double, std::micro>(t1 - t0).count();
+        wallSeconds += us * 1e-6;
+        blockUs.push_back(us);
+        blockAllocs.push_back(a1 - a0);
+
+        // unison caps come and go, so sample every block for the tightest one
+        conduit_render_load_t rl{};
+        if (renderLoad && renderLoad->get(plugin, &rl) && rl.unisonCap > 0)
+        {
+            res.minUnisonCap = res.minUnisonCap ? std::min(res.minUnisonCap, rl.unisonCap)
+                                                : rl.unisonCap;
+        }
+    }
+
+    conduit_render_load_t rl{};
+    if (renderLoad && renderLoad->get(plugin, &rl))
+    {
+        res.hasRenderLoad = true;
+        res.peakLoad = rl.peakLoad;
+        res.voicesShed = rl.voicesShed;
+        res.blocksOverLimit = rl.blocksOverLimit;
+    }
+
+    stop();
+    plugin->destroy(plugin);
+    res.rtViolations = rtc::violationCount() - violationsAtStart;
+
+    res.pluginId = desc->id;
+    res.voices = notes.voices;
+    res.threads = threads;
+    res.rtf = wallSeconds > 0 ? (nBlocks * opt.blockSize / opt.sampleRate) / wallSeconds : 0;
+
+    double totalUs{0};
+    for (auto us : blockUs)
+        totalUs += us;
+    if (res.voices > 0 && !blockUs.empty())
+        res.usPerVoice = totalUs / blockUs.size() / res.voices;
+
+    std::sort(blockUs.begin(), blockUs.end());
+    res.p50 = percentile(blockUs, 0.5);
+    res.p90 = percentile(blockUs, 0.9);
+    res.p99 = percentile(blockUs, 0.99);
+    res.p999 = percentile(blockUs, 0.999);
+    res.maxUs = blockUs.empty() ? 0 : blockUs.back();
+
+    uint64_t total{0};
+    for (auto a : blockAllocs)
+    {
+        total += a;
+        res.maxAllocsInBlock = std::max(res.maxAllocsInBlock, a);
+        res.blocksWhichAllocated += (a > 0);
+    }
+    res.allocsPerBlock = blockAllocs.empty() ? 0 : (double)total / blockAllocs.size();
+    return true;
+}
+
+static std::vector<std::string> splitList(const std::string &s)
+{
+    std::vector<std::string> res;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            res.push_back(item);
+    return res;
+}
+
+static std::vector<int> splitIntList(const std::string &s)
+{
+    std::vector<int> res;
+    for (auto &i : splitList(s))
+        res.push_back(std::atoi(i.c_str()));
+    return res;
+}
+
+static void usage()
+{
+    std::cout
+        << "Usage: conduit-bench [options]\n"
+        << "  --plugin a,b,..    plugin ids or id suffixes to run, or 'all'\n"
+        << "                     (default polysynth,polymetric-delay,ring-modulator)\n"
+        << "  --voices a,b,..    held notes for instruments; each value is a run\n"
+        << "                     (default 8,32,64)\n"
+        << "  --threads a,b,..   polysynth render threads; 0 is the default of 1\n"
+        << "  --seed n           polysynth random seed, the same for every run (default 1)\n"
+        << "  --seconds s        audio to render per run (default 10)\n"
+        << "  --rate sr          sample rate (default 48000)\n"
+        << "  --block n          block size (default 256)\n"
+        << "  --note-length s    seconds between retriggers of each voice (default 0.5)\n"
+        << "  --param-interval n samples between parameter changes (default 512)\n"
+        << "  --mod-interval n   samples between modulation events (default 64)\n"
+        << "  --min-rtf x        exit non-zero if any run renders slower than x times real time\n"
+        << "  --max-allocs x     exit non-zero if any run averages more allocations per block\n"
+        << "  --stepped-params   also automate stepped params, with random values\n"
+        << "  --stress           every plugin with dense, random automation, failing on any\n"
+        << "                     allocation in process; later options override its settings\n"
+        << "  --csv              machine readable output\n"
+        << "Builds with CONDUIT_RT_CHECKS also fail any run which reports an audio thread\n"
+        << "allocation or lock, and print where it came from.\n";
+}
+
+static bool parseArgs(int argc, char **argv, Options &opt)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string a = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+                std::cerr << "conduit-bench: " << a << " needs a value" << std::endl;
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        if (a == "--help" || a == "-h")
+        {
+            usage();
+            std::exit(0);
+        }
+        else if (a == "--plugin")
+            opt.plugins = splitList(next());
+        else if (a == "--voices")
+            opt.voices = splitIntList(next());
+        else if (a == "--threads")
+            opt.threads = splitIntList(next());
+        else if (a == "--seed")
+            opt.seed = std::strtoull(next().c_str(), nullptr, 0);
+        else if (a == "--seconds")
+            opt.seconds = std::atof(next().c_str());
+        else if (a == "--rate")
+            opt.sampleRate = std::atof(next().c_str());
+        else if (a == "--block")
+            opt.blockSize = (uint32_t)std::atoi(next().c_str());
+        else if (a == "--note-length")
+            opt.noteLength = std::atof(next().c_str());
+        else if (a == "--param-interval")
+            opt.paramInterval = std::max(1, std::atoi(next().c_str()));
+        else if (a == "--mod-interval")
+            opt.modInterval = std::max(1, std::atoi(next().c_str()));
+        else if (a == "--min-rtf")
+            opt.minRTF = std::atof(next().c_str());
+        else if (a == "--max-allocs")
+            opt.maxAllocs = std::atof(next().c_str());
+        else if (a == "--stepped-params")
+            opt.steppedParams = true;
+        else if (a == "--stress")
+        {
+            opt.plugins = {"all"};
+            opt.voices = {1, 64, 256};
+            opt.seconds = 4;
+            opt.noteLength = 0.05;
+            opt.paramInterval = 16;
+            opt.modInterval = 8;
+            opt.steppedParams = true;
+            opt.maxAllocs = 0;
+        }
+        else if (a == "--csv")
+            opt.csv = true;
+        else
+        {
+            std::cerr << "conduit-bench: unknown argument " << a << std::endl;
+            usage();
+            return false;
+        }
+    }
+    if (opt.blockSize == 0 || opt.sampleRate <= 0 || opt.seconds <= 0)
+    {
+        std::cerr << "conduit-bench: block, rate and seconds must be positive" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool matches(const std::vector<std::string> &wanted, const char *id)
+{
+    std::string sid = id;
+    for (auto &w : wanted)
+    {
+        if (w == "all" || sid == w)
+            return true;
+        if (sid.size() > w.size() && sid.compare(sid.size() - w.size(), w.size(), w) == 0 &&
+            sid[sid.size() - w.size() - 1] == '.')
+            return true;
+    }
+    return false;
+}
+
+static void report(const Result &r, bool csv)
+{
+    if (csv)
+    {
+        std::cout << r.pluginId << "," << r.voices << "," << r.threads << "," << r.rtf << ","
+                  << r.p50 << "," << r.p90 << "," << r.p99 << "," << r.p999 << "," << r.maxUs
+                  << "," << r.usPerVoice << "," << r.allocsPerBlock << ","
+                  << r.maxAllocsInBlock << "," << r.blocksWhichAllocated << ","
+                  << r.rtViolations << "," << r.peakLoad << "," << r.voicesShed << ","
+                  << r.minUnisonCap << "," << r.blocksOverLimit << "\n";
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(2) << std::left << std::setw(48) << r.pluginId
+              << std::right << " voices=" << std::setw(3) << r.voices << " thr=" << r.threads
+              << "  rtf=" << std::setw(8) << r.rtf << "  us p50/p90/p99/p99.9/max=" << r.p50
+              << "/" << r.p90 << "/" << r.p99 << "/" << r.p999 << "/" << r.maxUs;
+    if (r.voices > 0)
+        std::cout << "  us/voice=" << r.usPerVoice;
+    std::cout << "  allocs/block=" << r.allocsPerBlock << " (max " << r.maxAllocsInBlock << ", "
+              << r.blocksWhichAllocated << " blocks)";
+    if (r.hasRenderLoad)
+    {
+        std::cout << "  peak load=" << r.peakLoad * 100 << "%";
+        if (r.blocksOverLimit)
+            std::cout << " (over limit " << r.blocksOverLimit << " blocks, shed "
+                      << r.voicesShed << " voices)";
+        if (r.minUnisonCap)
+            std::cout << " unison capped to " << r.minUnisonCap;
+    }
+    if (r.rtViolations)
+        std::cout << "  rt violations=" << r.rtViolations;
+    std::cout << "\n";
+}
+} // namespace sst::conduit::bench
+
+int main(int argc, char **argv)
+{
+    namespace cb = sst::conduit::bench;
+
+    cb::Options opt;
+    if (!cb::parseArgs(argc, argv, opt))
+        return 2;
+
+    if (!clap_entry.init(argv[0]))
+    {
+        std::cerr << "conduit-bench: clap_entry.init failed" << std::endl;
+        return 1;
+    }
+    auto factory =
+        static_cast<const clap_plugin_factory_t *>(clap_entry.get_factory(CLAP_PLUGIN_FACTORY_ID));
+
+    if (opt.csv)
+        std::cout << "plugin,voices,threads,rtf,p50_us,p90_us,p99_us,p999_us,max_us,"
+                  << "us_per_voice,allocs_per_block,max_allocs_in_block,blocks_which_allocated,"
+                  << "rt_violations,peak_load,voices_shed,min_unison_cap,blocks_over_limit\n";
+
+    bool ok{true}, ranAny{false};
+    for (uint32_t pi = 0; pi < factory->get_plugin_count(factory); ++pi)
+    {
+        auto desc = factory->get_plugin_descriptor(factory, pi);
+        if (!desc || !cb::matches(opt.plugins, desc->id))
+            continue;
+
+        auto heldNotes{true};
+        for (auto v : opt.voices)
+        {
+            // an effect holds no notes, so it plays the same whatever the voice count
+            if (!heldNotes)
+                break;
+            for (auto t : opt.threads)
+            {
+                cb::Result r;
+                if (!cb::runOne(factory, desc, opt, v, t, r))
+                {
+                    ok = false;
+                    continue;
+                }
+                ranAny = true;
+                heldNotes = r.voices > 0 || v == 0;
+                cb::report(r, opt.csv);
+
+                if (opt.minRTF > 0 && r.rtf < opt.minRTF)
+                {
+                    std::cerr << "conduit-bench: " << r.pluginId << " ran at " << r.rtf
+                              << "x real time, below " << opt.minRTF << std::endl;
+                    ok = false;
+                }
+                if (opt.maxAllocs >= 0 && r.allocsPerBlock > opt.maxAllocs)
+                {
+                    std::cerr << "conduit-bench: " << r.pluginId << " made " << r.allocsPerBlock
+                              << " allocations per block, above " << opt.maxAllocs << std::endl;
+                    ok = false;
+                }
+                if (r.rtViolations > 0)
+                {
+                    std::cerr << "conduit-bench: " << r.pluginId << " allocated or locked "
+                              << r.rtViolations << " times on the audio thread" << std::endl;
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    clap_entry.deinit();
+
+    if (!ranAny)
+    {
+        std::cerr << "conduit-bench: no plugins matched" << std::endl;
+        return 2;
+    }
+    return ok ? 0 : 1;
+}
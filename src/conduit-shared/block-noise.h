@@ -0,0 +1,171 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_BLOCK_NOISE_H
+#define CONDUIT_SRC_CONDUIT_SHARED_BLOCK_NOISE_H
+
+#include <cmath>
+#include <cstdint>
+
+#include "sse-include.h"
+
+namespace sst::conduit::shared
+{
+/*
+ * BlockRNG makes uniform random floats a block at a time. It is four xorshift128
+ * generators side by side in SSE registers, so each step yields four values using only
+ * shifts and xors, and a float comes straight from the top 23 bits of each.
+ *
+ * The stream depends only on the seed, so a render is repeatable. Give instances or
+ * voices which should differ different seeds; seeds which are close together are fine
+ * since they are spread through splitmix64 first.
+ */
+struct BlockRNG
+{
+    static constexpr uint64_t defaultSeed{0x5eed'c0de'2024'0001ULL};
+
+    explicit BlockRNG(uint64_t seed = defaultSeed) { reseed(seed); }
+
+    void reseed(uint64_t seed)
+    {
+        uint32_t s alignas(16)[4][4];
+        for (auto &v : s)
+        {
+            for (auto &l : v)
+            {
+                seed += 0x9E3779B97F4A7C15ULL;
+                auto z = seed;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                l = (uint32_t)(z ^ (z >> 31)) | 1; // xorshift state must not be all zero
+            }
+        }
+        x = _mm_load_si128((const __m128i *)s[0]);
+        y = _mm_load_si128((const __m128i *)s[1]);
+        z = _mm_load_si128((const __m128i *)s[2]);
+        w = _mm_load_si128((const __m128i *)s[3]);
+        pos = bufferSize;
+    }
+
+    // N values in [-1, 1); N must be a multiple of 4 and out 16 byte aligned
+    template <int N> void fillBipolar(float *out)
+    {
+        static_assert(N % 4 == 0);
+        const auto two = _mm_set1_ps(2.f), three = _mm_set1_ps(3.f);
+        for (int i = 0; i < N; i += 4)
+            _mm_store_ps(out + i, _mm_sub_ps(_mm_mul_ps(nextOneToTwo(), two), three));
+    }
+
+    // N values in [0, 1); N must be a multiple of 4 and out 16 byte aligned
+    template <int N> void fillUnipolar(float *out)
+    {
+        static_assert(N % 4 == 0);
+        const auto one = _mm_set1_ps(1.f);
+        for (int i = 0; i < N; i += 4)
+            _mm_store_ps(out + i, _mm_sub_ps(nextOneToTwo(), one));
+    }
+
+    // One value in [0, 1), for callers which want them singly
+    float unipolar()
+    {
+        if (pos == bufferSize)
+        {
+            fillUnipolar<bufferSize>(buffer);
+            pos = 0;
+        }
+        return buffer[pos++];
+    }
+
+  private:
+    __m128 nextOneToTwo()
+    {
+        auto t = _mm_xor_si128(x, _mm_slli_epi32(x, 11));
+        x = y;
+        y = z;
+        z = w;
+        w = _mm_xor_si128(_mm_xor_si128(w, _mm_srli_epi32(w, 19)),
+                          _mm_xor_si128(t, _mm_srli_epi32(t, 8)));
+        auto bits = _mm_or_si128(_mm_srli_epi32(w, 9), _mm_set1_epi32(0x3F800000));
+        return _mm_castsi128_ps(bits);
+    }
+
+    __m128i x, y, z, w;
+    static constexpr int bufferSize{16};
+    float buffer alignas(16)[bufferSize];
+    int pos{bufferSize};
+};
+
+/*
+ * The two pole correlated noise filter of sst::basic_blocks::dsp::
+ * correlated_noise_o2mk2_supplied_value, run over a block with the correlation held.
+ * Each pole is y[n] = b x[n] + c y[n-1]; we solve four samples of that at once as a
+ * prefix scan in two shift-and-add steps, then carry the last lane into the next four.
+ */
+struct CorrelatedNoise
+{
+    void reset()
+    {
+        lastval = 0.f;
+        lastval2 = 0.f;
+    }
+
+    // Turns N bipolar uniform values into correlated noise in place; N a multiple of 4
+    template <int N> void process(float correlation, float *inout)
+    {
+        static_assert(N % 4 == 0);
+        float wf = correlation * 0.9f;
+        float wfabs = std::fabs(wf);
+        float b = 1.f - wfabs, c = -wf;
+        float m = 1.f / std::sqrt(1.f - wfabs);
+
+        const auto bv = _mm_set1_ps(b), c1 = _mm_set1_ps(c), c2 = _mm_set1_ps(c * c);
+        const auto cPow = _mm_setr_ps(c, c * c, c * c * c, c * c * c * c);
+        const auto mv = _mm_set1_ps(m);
+
+        auto pole = [&](__m128 in, float &last) {
+            auto t = _mm_mul_ps(bv, in);
+            t = _mm_add_ps(t, _mm_mul_ps(c1, shiftUp<1>(t)));
+            t = _mm_add_ps(t, _mm_mul_ps(c2, shiftUp<2>(t)));
+            t = _mm_add_ps(t, _mm_mul_ps(cPow, _mm_set1_ps(last)));
+            last = _mm_cvtss_f32(_mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 3, 3, 3)));
+            return t;
+        };
+
+        for (int i = 0; i < N; i += 4)
+        {
+            auto v = pole(_mm_load_ps(inout + i), lastval2);
+            v = pole(v, lastval);
+            _mm_store_ps(inout + i, _mm_mul_ps(v, mv));
+        }
+    }
+
+  private:
+    // lane k takes lane k - n, with zeros shifted in at lane 0
+    template <int n> static __m128 shiftUp(__m128 v)
+    {
+        return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(v), 4 * n));
+    }
+
+    float lastval{0.f}, lastval2{0.f};
+};
+} // namespace sst::conduit::shared
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_BLOCK_NOISE_H
@@ -23,6 +23,15 @@
 #define CONDUIT_SRC_CONDUIT_SHARED_CLAP_BASE_CLASS_H
 
 #include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 #include <type_traits>
@@ -48,6 +57,9 @@
 #include <sst/basic-blocks/params/ParamMetadata.h>
 #include <sst/clap_juce_shim/clap_juce_shim.h>
 #include "debug-helpers.h"
+#include "rt-check.h"
+#include "state-codec.h"
+#include "tail.h"
 
 namespace sst::conduit::shared
 {
@@ -68,7 +80,7 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
     using config_t = TConfig;
 
     ClapBaseClass(const clap_host *host)
-        : plugHelper_t(TConfig::getDescription(), host), uiComms(*this)
+        : plugHelper_t(TConfig::getDescription(), host), patchIOHandler(*this), uiComms(*this)
     {
         dbToLinearTable.init();
         equalTuningTable.init();
@@ -77,7 +89,7 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
     }
 
     ClapBaseClass(const clap_plugin_descriptor *desc, const clap_host *host)
-        : plugHelper_t(desc, host), uiComms(*this)
+        : plugHelper_t(desc, host), patchIOHandler(*this), uiComms(*this)
     {
         dbToLinearTable.init();
         equalTuningTable.init();
@@ -91,7 +103,40 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
 
     using ParamDesc = sst::basic_blocks::params::ParamMetaData;
     std::vector<ParamDesc> paramDescriptions;
-    std::unordered_map<uint32_t, ParamDesc> paramDescriptionMap;
+
+    /*
+     * Params are found by id through flat tables which configureParams builds once, rather
+     * than through node based maps. paramSlots is a perfect hash: one multiply and shift
+     * lands on the only slot an id can be in, so a lookup is a single compare. Should no
+     * multiplier separate the ids we binary search sortedParamIds instead. Everything else
+     * about a param lives in arrays by patch index. Code which knows an id at compile time
+     * can resolve it to a constant, as ConduitPolysynth::patchIndexOf does.
+     */
+    struct ParamIndexEntry
+    {
+        clap_id id{0};
+        int index{-1};
+    };
+    std::array<ParamIndexEntry, TConfig::nParams> sortedParamIds{};
+    std::vector<ParamIndexEntry> paramSlots;
+    uint32_t paramSlotMul{0}, paramSlotShift{32};
+
+    // The patch index of a param id, or -1 if it isn't one of ours
+    int paramIndexOf(clap_id id) const
+    {
+        if (!paramSlots.empty())
+        {
+            // empty slots have index -1, so whichever id they hold the answer is right
+            const auto &e = paramSlots[(uint32_t)(id * paramSlotMul) >> paramSlotShift];
+            return e.id == id ? e.index : -1;
+        }
+
+        auto it = std::lower_bound(sortedParamIds.begin(), sortedParamIds.end(), id,
+                                   [](const auto &e, clap_id i) { return e.id < i; });
+        if (it == sortedParamIds.end() || it->id != id)
+            return -1;
+        return it->index;
+    }
 
     sst::basic_blocks::tables::DbToLinearProvider dbToLinearTable;
     sst::basic_blocks::tables::EqualTuningProvider equalTuningTable;
@@ -110,33 +155,81 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
     {
         cbassert(paramDescriptions.size() == TConfig::nParams,
                  "Incorrect size " << TConfig::nParams << " vs " << paramDescriptions.size());
-        paramDescriptionMap.clear();
-        int patchIdx{0};
-        for (const auto &pd : paramDescriptions)
+        for (auto patchIdx = 0U; patchIdx < TConfig::nParams; ++patchIdx)
         {
-            // If you hit this cbassert you have a duplicate param id
-            cbassert(paramDescriptionMap.find(pd.id) == paramDescriptionMap.end(),
-                     "Duplicate Param IDs");
-            paramDescriptionMap[pd.id] = pd;
-            paramToPatchIndex[pd.id] = patchIdx;
-            paramToValue[pd.id] = &(patch.params[patchIdx]);
+            const auto &pd = paramDescriptions[patchIdx];
+            sortedParamIds[patchIdx] = {pd.id, (int)patchIdx};
 
             patch.params[patchIdx] = pd.defaultVal;
             if (TConfig::baseClassProvidesMonoModSupport)
             {
                 monoModulatedPatch.update(patchIdx, patch);
             }
+        }
 
-            patchIdx++;
+        std::sort(sortedParamIds.begin(), sortedParamIds.end(),
+                  [](const auto &a, const auto &b) { return a.id < b.id; });
+        for (auto i = 1U; i < TConfig::nParams; ++i)
+        {
+            // If you hit this cbassert you have a duplicate param id
+            cbassert(sortedParamIds[i - 1].id != sortedParamIds[i].id, "Duplicate Param IDs");
         }
-        cbassert(paramDescriptionMap.size() == TConfig::nParams, "Bad Traversal");
-        cbassert(patchIdx == TConfig::nParams, "Bad Traversal");
+
+        buildParamSlots();
+    }
+
+    /*
+     * Tries odd multipliers over tables from two to sixteen slots per param until one puts
+     * every id in a slot of its own. With a few hundred slots for a hundred ids that takes
+     * a handful of tries; the multipliers come from a fixed sequence so it's repeatable.
+     */
+    void buildParamSlots()
+    {
+        paramSlots.clear();
+        uint32_t bits{1};
+        while ((1U << bits) < 2 * TConfig::nParams)
+            bits++;
+
+        uint64_t seed{0x9E3779B97F4A7C15ULL};
+        std::vector<ParamIndexEntry> slots;
+        for (auto b = bits; b <= bits + 3 && b < 32; ++b)
+        {
+            for (int attempt = 0; attempt < 256; ++attempt)
+            {
+                seed += 0x9E3779B97F4A7C15ULL;
+                auto z = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                auto mul = (uint32_t)(z >> 32) | 1;
+                auto shift = 32 - b;
+
+                slots.assign(1U << b, ParamIndexEntry());
+                bool separated{true};
+                for (const auto &e : sortedParamIds)
+                {
+                    auto &slot = slots[(uint32_t)(e.id * mul) >> shift];
+                    if (slot.index >= 0)
+                    {
+                        separated = false;
+                        break;
+                    }
+                    slot = e;
+                }
+                if (separated)
+                {
+                    paramSlots = std::move(slots);
+                    paramSlotMul = mul;
+                    paramSlotShift = shift;
+                    return;
+                }
+            }
+        }
+        CNDOUT << "No perfect hash for the param ids; looking them up by binary search"
+               << std::endl;
     }
 
     bool implementsParams() const noexcept override { return true; }
     bool isValidParamId(clap_id paramId) const noexcept override
     {
-        return paramDescriptionMap.find(paramId) != paramDescriptionMap.end();
+        return paramIndexOf(paramId) >= 0;
     }
     uint32_t paramsCount() const noexcept override { return TConfig::nParams; }
     bool paramsInfo(uint32_t paramIndex, clap_param_info *info) const noexcept override
@@ -152,7 +245,13 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
 
     bool paramsValue(clap_id paramId, double *value) noexcept override
     {
-        *value = *paramToValue[paramId];
+        auto idx = paramIndexOf(paramId);
+        if (idx < 0)
+            return false;
+
+        std::lock_guard<std::mutex> g(hostLoadMutex);
+        auto hp = pendingHostLoad();
+        *value = hp && hp->restored[idx] ? hp->params[idx] : patch.params[idx];
         return true;
     }
     bool paramsValueToText(clap_id paramId, double value, char *display,
@@ -169,20 +268,20 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
 
     std::optional<std::string> paramValueDisplay(clap_id paramId, double value) const
     {
-        auto pos = paramDescriptionMap.find(paramId);
-        if (pos == paramDescriptionMap.end())
+        auto idx = paramIndexOf(paramId);
+        if (idx < 0)
             return std::nullopt;
 
-        const auto &pd = pos->second;
+        const auto &pd = paramDescriptions[idx];
         ParamDesc::FeatureState fs;
 
         auto tsBuddy = temposyncActivatedBy.find(paramId);
         if (tsBuddy != temposyncActivatedBy.end())
         {
-            auto pvIt = paramToValue.find(tsBuddy->second);
-            if (pvIt != paramToValue.end())
+            auto tsIdx = paramIndexOf(tsBuddy->second);
+            if (tsIdx >= 0)
             {
-                auto isTS = *(pvIt->second) > 0.5;
+                auto isTS = patch.params[tsIdx] > 0.5;
                 fs = fs.withTemposync(isTS);
             }
         }
@@ -193,11 +292,11 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
 
     bool paramsTextToValue(clap_id paramId, const char *display, double *value) noexcept override
     {
-        auto pos = paramDescriptionMap.find(paramId);
-        if (pos == paramDescriptionMap.end())
+        auto idx = paramIndexOf(paramId);
+        if (idx < 0)
             return false;
 
-        const auto &pd = pos->second;
+        const auto &pd = paramDescriptions[idx];
 
         std::string emsg;
         auto res = pd.valueFromString(display, emsg);
@@ -235,24 +334,23 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
         }
     } monoModulatedPatch;
 
-    std::unordered_map<clap_id, float *> paramToValue;
-    std::unordered_map<clap_id, int> paramToPatchIndex;
-
     using lag_t = sst::basic_blocks::dsp::SurgeLag<float, true>;
-    std::unordered_map<clap_id, lag_t *> paramToLag;
+    // by patch index for updates, and packed for processLags
+    std::array<lag_t *, TConfig::nParams> lagByIndex{};
+    std::vector<lag_t *> attachedLags;
 
     void processLags()
     {
-        for (const auto lp : paramToLag)
+        for (auto lp : attachedLags)
         {
-            lp.second->process();
+            lp->process();
         }
     }
 
     void attachParam(clap_id paramId, float *&to)
     {
-        auto ptpi = paramToPatchIndex.find(paramId);
-        if (ptpi == paramToPatchIndex.end())
+        auto idx = paramIndexOf(paramId);
+        if (idx < 0)
         {
             to = nullptr;
         }
@@ -260,11 +358,11 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
         {
             if (TConfig::baseClassProvidesMonoModSupport)
             {
-                to = &monoModulatedPatch.values[ptpi->second];
+                to = &monoModulatedPatch.values[idx];
             }
             else
             {
-                to = &patch.params[ptpi->second];
+                to = &patch.params[idx];
             }
         }
     }
@@ -272,19 +370,20 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
     void attachParam(clap_id paramId, lag_t &to)
     {
         auto val = 0.f;
-        auto ptpi = paramToPatchIndex.find(paramId);
-        if (ptpi != paramToPatchIndex.end())
+        auto idx = paramIndexOf(paramId);
+        if (idx >= 0)
         {
             if (TConfig::baseClassProvidesMonoModSupport)
             {
-                val = monoModulatedPatch.values[ptpi->second];
+                val = monoModulatedPatch.values[idx];
             }
             else
             {
-                val = patch.params[ptpi->second];
+                val = patch.params[idx];
             }
+            lagByIndex[idx] = &to;
         }
-        paramToLag[paramId] = &to;
+        attachedLags.push_back(&to);
         to.newValue(val);
         to.instantize();
     }
@@ -302,82 +401,237 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
         }
 
         handleEventsFromUIQueue(out);
+        patchIOHandler.applyNow();
     }
 
   public:
-    static constexpr int streamingVersion{1};
+    /*
+     * Version 1 was xml. Version 2 is the binary encoding of state-codec.h, which is what we
+     * write; stateLoad still reads either.
+     */
+    static constexpr int streamingVersion{2};
     bool implementsState() const noexcept override { return true; }
     bool stateSave(const clap_ostream *ostream) noexcept override
     {
-        TiXmlDocument document;
+        std::lock_guard<std::mutex> g(hostLoadMutex);
+        auto hp = pendingHostLoad();
 
-        TiXmlElement conduit("conduit");
-        conduit.SetAttribute("streamingVersion", streamingVersion);
-        conduit.SetAttribute("plugin_id", TConfig::getDescription()->id);
+        StateWriter w(ostream);
+        w.bytes(stateMagic, sizeof(stateMagic));
+        w.u32(streamingVersion);
 
-        TiXmlElement paramel("params");
-        for (const auto &a : paramDescriptions)
+        w.chunk(stateChunkPlugin, [](auto &c) {
+            c.string(TConfig::getDescription()->id);
+            return true;
+        });
+        w.chunk(stateChunkParams, [this, hp](auto &c) {
+            c.u32(TConfig::nParams);
+            for (auto i = 0U; i < TConfig::nParams; ++i)
+            {
+                c.u32(paramDescriptions[i].id);
+                c.f32(hp && hp->restored[i] ? hp->params[i] : patch.params[i]);
+            }
+            return true;
+        });
+        if constexpr (TConfig::PatchExtension::hasExtension)
         {
-            TiXmlElement par("param");
-            par.SetAttribute("id", a.id);
-            par.SetDoubleAttribute("value", *(paramToValue[a.id]));
-            par.SetAttribute("name", a.name); // just to debug;
-            paramel.InsertEndChild(par);
+            const auto &ext = hp ? hp->extension : patch.extension;
+            if (!w.chunk(stateChunkExtension, [&ext](auto &c) { return ext.toBinary(c); }))
+                return false;
         }
-        conduit.InsertEndChild(paramel);
-
-        if constexpr (TConfig::PatchExtension::hasExtension)
+        return w.finish();
+    }
+    bool stateLoad(const clap_istream *istream) noexcept override
+    {
+        if (!isActive())
         {
-            TiXmlElement ext("extension");
-            if (!patch.extension.toXml(ext))
+            auto ps = std::make_unique<PreparedState>();
+            if (!stateFromStream(istream, *ps))
                 return false;
-            conduit.InsertEndChild(ext);
+            // anything still waiting from before would land on top of this at activate
+            patchIOHandler.publish(nullptr);
+            applyPreparedState(*ps);
+            return true;
+        }
+
+        /*
+         * Process may be reading the patch, so it swaps this in itself, faded, as for the UI.
+         * Until it has, stateSave and paramsValue answer from a second copy parsed here, so a
+         * host querying straight after a load sees what it loaded.
+         */
+        std::string bytes;
+        StateReader(istream).readRest(bytes);
+        auto ps = std::make_unique<PreparedState>();
+        auto view = std::make_unique<PreparedState>();
+        StateReader forProcess(bytes.data(), bytes.size()), forView(bytes.data(), bytes.size());
+        if (!stateFromReader(forProcess, *ps) || !stateFromReader(forView, *view))
+            return false;
+
+        ps->hostLoad = view->hostLoad = ++hostLoadsMade;
+        {
+            std::lock_guard<std::mutex> g(hostLoadMutex);
+            hostLoadView = std::move(view);
         }
+        patchIOHandler.publish(std::move(ps));
+        if (_host.canUseParams())
+            _host.paramsRequestFlush();
+        return true;
+    }
+
+    /*
+     * A parsed patch which hasn't been applied yet. Parsing only reads the parameter tables,
+     * so the patch io thread can do it while process runs; applying it is then just copies.
+     */
+    struct PreparedState
+    {
+        float params[TConfig::nParams]{};
+        bool restored[TConfig::nParams]{};
+        typename TConfig::PatchExtension extension;
+        uint64_t hostLoad{0}; // which host stateLoad this came from, if any
+    };
 
-        document.InsertEndChild(conduit);
+    /*
+     * A host stateLoad made while active, until process swaps it in or a later load replaces
+     * it. Guarded by hostLoadMutex since the patch io thread saves through stateSave too.
+     */
+    std::mutex hostLoadMutex;
+    std::unique_ptr<PreparedState> hostLoadView;
+    uint64_t hostLoadsMade{0};
+    std::atomic<uint64_t> hostLoadsDone{0}; // the latest applied or replaced
 
-        TiXmlPrinter pr;
-        document.Accept(&pr);
+    // [main-thread or io-thread] with hostLoadMutex held
+    const PreparedState *pendingHostLoad()
+    {
+        if (hostLoadView && hostLoadsDone.load(std::memory_order_acquire) >= hostLoadView->hostLoad)
+            hostLoadView.reset();
+        return hostLoadView.get();
+    }
 
-        auto xmlS = pr.Str();
+    // Reads either encoding, telling them apart by the binary magic
+    bool stateFromStream(const clap_istream *istream, PreparedState &into) const
+    {
+        StateReader r(istream);
+        return stateFromReader(r, into);
+    }
 
-        auto c = xmlS.c_str();
-        auto s = xmlS.length(); // write the null terminator
-        while (s > 0)
+    bool stateFromReader(StateReader &r, PreparedState &into) const
+    {
+        char head[sizeof(stateMagic)];
+        if (!r.bytes(head, sizeof(head)))
         {
-            auto r = ostream->write(ostream, c, s);
-            if (r < 0)
-                return false;
-            s -= r;
-            c += r;
+            CNDOUT << "State stream is too short to hold a state" << std::endl;
+            return false;
         }
-        return true;
+        if (memcmp(head, stateMagic, sizeof(head)) == 0)
+            return stateFromBinary(r, into);
+
+        std::string xd(head, sizeof(head));
+        r.readRest(xd);
+        return stateFromXml(xd, into);
     }
-    bool stateLoad(const clap_istream *istream) noexcept override
+
+    bool stateFromBinary(StateReader &r, PreparedState &into) const
     {
-        static constexpr uint32_t maxSize = 1 << 16, chunkSize = 1 << 8;
-        char buffer[maxSize];
-        char *bp = &(buffer[0]);
-        int64_t rd{0};
-        int64_t totalRd{0};
+        uint32_t sv;
+        if (!r.u32(sv))
+        {
+            CNDOUT << "State stream has no version" << std::endl;
+            return false;
+        }
+        if (sv > (uint32_t)streamingVersion)
+        {
+            CNDOUT << "Streaming version '" << sv << "' greater than '" << streamingVersion << "'"
+                   << std::endl;
+            return false;
+        }
 
-        buffer[0] = 0;
-        while ((rd = istream->read(istream, bp, chunkSize)) > 0)
+        bool hasPluginId{false};
+        uint32_t tag;
+        std::string body;
+        while (!r.atEnd())
         {
-            bp += rd;
-            totalRd += rd;
-            if (totalRd >= maxSize - chunkSize - 1)
+            if (!r.chunk(tag, body))
             {
-                CNDOUT << "Input byte stream larger than " << maxSize << "; Failing" << std::endl;
+                CNDOUT << "State stream ends inside a chunk" << std::endl;
                 return false;
             }
+
+            StateReader c(body.data(), body.size());
+            switch (tag)
+            {
+            case stateChunkPlugin:
+            {
+                std::string spid;
+                if (!c.string(spid) || spid != TConfig::getDescription()->id)
+                {
+                    CNDOUT << "State file for '" << spid << "' doesn't match plugin id '"
+                           << TConfig::getDescription()->id << "'" << std::endl;
+                    return false;
+                }
+                hasPluginId = true;
+            }
+            break;
+            case stateChunkParams:
+            {
+                uint32_t n;
+                if (!c.u32(n))
+                    return false;
+                int restoredParams{0};
+                for (auto i = 0U; i < n; ++i)
+                {
+                    uint32_t id;
+                    float value;
+                    if (!c.u32(id) || !c.f32(value))
+                    {
+                        CNDOUT << "Params chunk is short" << std::endl;
+                        return false;
+                    }
+                    restoredParams += prepareParam(into, id, value);
+                }
+                if (restoredParams != TConfig::nParams)
+                {
+                    CNDOUT << "Warning : Restored " << restoredParams << " vs expected "
+                           << TConfig::nParams << std::endl;
+                }
+            }
+            break;
+            case stateChunkExtension:
+                if constexpr (TConfig::PatchExtension::hasExtension)
+                {
+                    if (!into.extension.fromBinary(c))
+                        return false;
+                }
+                break;
+            default:
+                // something from a later version; its length let us step over it
+                break;
+            }
         }
 
-        if (totalRd < maxSize)
-            buffer[totalRd] = 0;
+        if (!hasPluginId)
+        {
+            CNDOUT << "Cannot determine plugin id from stream" << std::endl;
+            return false;
+        }
+        return true;
+    }
 
-        auto xd = std::string(buffer);
+    // false, and the value dropped, if the id isn't one of ours
+    bool prepareParam(PreparedState &into, clap_id id, float value) const
+    {
+        auto idx = paramIndexOf(id);
+        if (idx < 0)
+        {
+            CNDOUT << "Unknown parameter " << id << " in stream" << std::endl;
+            return false;
+        }
+        into.params[idx] = value;
+        into.restored[idx] = true;
+        return true;
+    }
 
+    bool stateFromXml(const std::string &xd, PreparedState &into) const
+    {
         TiXmlDocument document;
         // I forget how to error check this.
         document.Parse(xd.c_str());
@@ -457,25 +711,8 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
                 goto nextParam;
             }
 
-            {
-                auto pos = paramToValue.find((clap_id)id);
-                if (pos != paramToValue.end())
-                {
-                    restoredParams++;
-                    *paramToValue[(clap_id)id] = value;
-                }
-                else
-                {
-                    CNDOUT << "Unknown parameter " << id << " in stream" << std::endl;
-                    // continue anyway
-                }
-                auto plv = paramToLag.find(id);
-                if (plv != paramToLag.end())
-                {
-                    plv->second->newValue(value);
-                    plv->second->instantize();
-                }
-            }
+            // unknown ids are logged and we continue anyway
+            restoredParams += prepareParam(into, (clap_id)id, value);
         nextParam:
             currParam = TINYXML_SAFE_TO_ELEMENT(currParam->NextSiblingElement("param"));
         }
@@ -491,19 +728,45 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
             auto ext = TINYXML_SAFE_TO_ELEMENT(conduit->FirstChild("extension"));
             if (ext)
             {
-                if (!patch.extension.fromXml(ext))
+                if (!into.extension.fromXml(ext))
                 {
                     return false;
                 }
             }
         }
+        return true;
+    }
+
+    /*
+     * Copies a prepared state into the patch. The extension is swapped rather than copied,
+     * so from has the old one afterwards and nothing here allocates or frees; whoever owns
+     * from decides where that happens.
+     */
+    void applyPreparedState(PreparedState &from)
+    {
+        for (auto i = 0U; i < TConfig::nParams; ++i)
+        {
+            if (!from.restored[i])
+                continue;
+
+            patch.params[i] = from.params[i];
+            if (auto lag = lagByIndex[i])
+            {
+                lag->newValue(from.params[i]);
+                lag->instantize();
+            }
+        }
+
+        if constexpr (TConfig::PatchExtension::hasExtension)
+        {
+            std::swap(patch.extension, from.extension);
+        }
 
         if (TConfig::baseClassProvidesMonoModSupport)
         {
             monoModulatedPatch.updateAll(patch);
         }
         onStateRestored();
-        return true;
     }
 
     virtual void onStateRestored() {}
@@ -544,8 +807,6 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
             BEGIN_EDIT = 0xF9,
             END_EDIT,
             ADJUST_VALUE,
-            LOAD_PATCH,
-            SAVE_PATCH,
 
             SPECIALIZED // basically use the id as a router
         } type;
@@ -553,8 +814,6 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
 
         double value{};
 
-        char *strPointer{nullptr};
-
         template <bool Cond, typename Tp> struct specTypeTrait
         {
             typedef int type;
@@ -569,13 +828,20 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
             specializedMessage{};
     };
 
-    /* In the future we will want this off audio thread with a tiny
-     * fade and stuff but not yet. Anticipating that though at least
-     * make a class that does the doohickies so later we can do asynch
-     * of thread etc...
+    /*
+     * Patch files from the UI are read, parsed and written on a thread of their own, started
+     * the first time the UI asks for one, so process never touches the disk. A loaded patch
+     * comes back as a PreparedState which process swaps in at the top of a block.
      *
-     * This implementation misses many basic things including error
-     * handling
+     * Process fades its output to nothing over the end of the block where a load arrives,
+     * applies the state at the start of the next and fades back in, so the jump in every
+     * parameter at once doesn't click. The silence at the end of the fade out lasts as long
+     * as the plugin's latency, so what is still in flight from the old patch is gone before
+     * the new one starts. Plugins hold a PatchSwapScope over process for that. While not
+     * processing paramsFlush applies anything waiting at once, and once the plugin's
+     * TailTracker has put it to sleep its output is already silent, so a swap is applied at
+     * once there too; otherwise the sleep fast path would leave it half done. A host's
+     * stateLoad while we are active comes through here too.
      */
     struct PatchIOHandler
     {
@@ -584,81 +850,276 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
             SAVE,
             LOAD
         };
-        // but for now its a hack that just does it directly
-        void enqueueOperation(ClapBaseClass<T, TConfig> &that, Op operation, char *pointerToPath)
+        static constexpr uint32_t fadeSamples{256};
+
+        PatchIOHandler(ClapBaseClass<T, TConfig> &h) : cp(h) {}
+        ~PatchIOHandler()
+        {
+            {
+                std::lock_guard<std::mutex> g(mutex);
+                stopping = true;
+            }
+            cv.notify_all();
+            if (worker.joinable())
+                worker.join();
+
+            delete loaded.exchange(nullptr);
+            delete swapping;
+            releaseRetired();
+        }
+
+        // [any-thread] A load process never picked up is simply replaced
+        void publish(std::unique_ptr<PreparedState> ps)
+        {
+            auto replaced = loaded.exchange(ps.release(), std::memory_order_acq_rel);
+            if (replaced)
+                markDone(*replaced);
+            delete replaced;
+        }
+
+        // [main-thread or io-thread] frees what process has swapped out
+        void releaseRetired()
+        {
+            std::lock_guard<std::mutex> g(retiredMutex);
+            while (!retired.empty())
+                delete *retired.pop();
+        }
+
+        // [main-thread]
+        void enqueueOperation(Op operation, const std::filesystem::path &path)
+        {
+            std::lock_guard<std::mutex> g(mutex);
+            requests.emplace_back(operation, path);
+            if (!worker.joinable())
+                worker = std::thread([this]() { run(); });
+            cv.notify_one();
+        }
+
+        // [audio-thread] at the top of process
+        void beginBlock(const clap_process *process)
         {
-            try
+            // The last block was silent, so there is nothing to fade
+            auto silent = process->audio_outputs_count == 0 || cp.tail.asleep;
+            if (swapping && (fadeOutLeft == 0 || silent))
             {
-                std::filesystem::path fsp{pointerToPath};
-                delete pointerToPath;
+                apply(swapping);
+                swapping = nullptr;
+                fadeInPos = silent ? fadeSamples : 0;
+            }
+            if (swapping)
+                return;
+
+            swapping = loaded.exchange(nullptr, std::memory_order_acq_rel);
+            if (swapping && silent)
+            {
+                apply(swapping);
+                swapping = nullptr;
+            }
+            fadeHold = cp.implementsLatency() ? cp.latencyGet() : 0;
+            fadeOutLeft = fadeSamples + fadeHold;
+        }
+
+        // [audio-thread] once the outputs are written
+        void endBlock(const clap_process *process)
+        {
+            if (!swapping && fadeInPos >= fadeSamples)
+                return;
 
-                if (operation == SAVE)
+            auto frames = process->frames_count;
+            for (auto p = 0U; p < process->audio_outputs_count; ++p)
+            {
+                auto &ob = process->audio_outputs[p];
+                if (!ob.data32)
+                    continue;
+                for (auto c = 0U; c < ob.channel_count; ++c)
                 {
-                    std::ofstream ofs(fsp, std::ios::out | std::ios::binary);
-                    if (!ofs.is_open())
-                    {
-                        CNDOUT << "Unable to open for writing " << fsp.u8string() << std::endl;
-                        return;
-                    }
-                    CNDOUT << "Writing patch to " << fsp.u8string() << std::endl;
-                    clap_ostream cos{};
-                    cos.ctx = &ofs;
-                    cos.write = clapwrite;
-                    that.stateSave(&cos);
-                    ofs.close();
+                    auto d = ob.data32[c];
+                    for (auto i = 0U; i < frames; ++i)
+                        d[i] *= gainAt(i, frames);
                 }
-                else
+                ob.constant_mask = 0;
+            }
+
+            fadeInPos = std::min(fadeInPos + frames, fadeSamples);
+            if (swapping)
+                fadeOutLeft = fadeOutLeft > frames ? fadeOutLeft - frames : 0;
+        }
+
+        // [main-thread or audio-thread while not processing]
+        void applyNow()
+        {
+            if (swapping)
+                apply(swapping);
+            swapping = nullptr;
+            fadeInPos = fadeSamples;
+            if (auto ps = loaded.exchange(nullptr, std::memory_order_acq_rel))
+                apply(ps);
+        }
+
+      private:
+        /*
+         * The fade in runs from the start of the block after a swap. The fade out ends on
+         * the last sample of a block, so the swap itself lands on a block boundary: the gain
+         * holds until fadeOutLeft samples from the end, falls to zero over fadeSamples and
+         * stays there for the last fadeHold.
+         */
+        float gainAt(uint32_t i, uint32_t frames) const
+        {
+            auto g = std::min(1.f, (float)(fadeInPos + i) / fadeSamples);
+            if (swapping)
+            {
+                auto left = std::min(fadeOutLeft, std::max(fadeOutLeft, frames) - i - 1);
+                g *= left > fadeHold ? (float)(left - fadeHold) / fadeSamples : 0.f;
+            }
+            return g;
+        }
+
+        void apply(PreparedState *ps)
+        {
+            cp.applyPreparedState(*ps);
+            markDone(*ps);
+            // ps now holds the old extension; the main or io thread frees it
+            retired.push(ps);
+
+            cp.uiComms.refreshUIValues = true;
+            if (cp._host.canUseParams())
+                cp.onMainAction |= OnMainAction::RESCAN;
+            cp._host.requestCallback();
+        }
+
+        void markDone(const PreparedState &ps)
+        {
+            if (ps.hostLoad)
+                cp.hostLoadsDone.store(ps.hostLoad, std::memory_order_release);
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                cv.wait(lock, [this]() { return stopping || !requests.empty(); });
+                if (stopping)
+                    return;
+
+                auto [operation, fsp] = requests.front();
+                requests.pop_front();
+                lock.unlock();
+
+                releaseRetired();
+                try
                 {
-                    std::ifstream ifs(fsp, std::ios::in | std::ios::binary);
-                    if (!ifs.is_open())
-                    {
-                        CNDOUT << "Unable to open for reading " << fsp.u8string() << std::endl;
-                        return;
-                    }
-                    CNDOUT << "Reading patch from " << fsp.u8string() << std::endl;
-                    clap_istream cis{};
-                    cis.ctx = &ifs;
-                    cis.read = clapread;
-                    that.stateLoad(&cis);
-                    ifs.close();
-
-                    that.uiComms.refreshUIValues = true;
-                    if (that._host.canUseParams())
-                    {
-                        that.onMainAction |= OnMainAction::RESCAN;
-                        that._host.requestCallback();
-                    }
+                    if (operation == SAVE)
+                        save(fsp);
+                    else
+                        load(fsp);
+                }
+                catch (const std::filesystem::filesystem_error &e)
+                {
+                    CNDOUT << "Patch IO failed : " << e.what() << std::endl;
                 }
+
+                lock.lock();
+            }
+        }
+
+        /*
+         * This is the host's stateSave, and like a host's call it reads the live patch while
+         * process may be changing it; the worst case is a value from one side of an edit.
+         */
+        void save(const std::filesystem::path &fsp)
+        {
+            std::ofstream ofs(fsp, std::ios::out | std::ios::binary);
+            if (!ofs.is_open())
+            {
+                CNDOUT << "Unable to open for writing " << fsp.u8string() << std::endl;
+                return;
+            }
+            CNDOUT << "Writing patch to " << fsp.u8string() << std::endl;
+            clap_ostream cos{};
+            cos.ctx = &ofs;
+            cos.write = clapwrite;
+            if (!cp.stateSave(&cos))
+                CNDOUT << "Unable to write patch to " << fsp.u8string() << std::endl;
+        }
+
+        void load(const std::filesystem::path &fsp)
+        {
+            std::ifstream ifs(fsp, std::ios::in | std::ios::binary);
+            if (!ifs.is_open())
+            {
+                CNDOUT << "Unable to open for reading " << fsp.u8string() << std::endl;
+                return;
             }
-            catch (const std::filesystem::filesystem_error &e)
+            CNDOUT << "Reading patch from " << fsp.u8string() << std::endl;
+            clap_istream cis{};
+            cis.ctx = &ifs;
+            cis.read = clapread;
+
+            auto ps = std::make_unique<PreparedState>();
+            if (!cp.stateFromStream(&cis, *ps))
             {
+                CNDOUT << "Unable to read patch from " << fsp.u8string() << std::endl;
+                return;
             }
+
+            publish(std::move(ps));
+
+            // Flush gets us applied if we aren't processing; process picks it up if we are
+            if (cp._host.canUseParams())
+                cp._host.paramsRequestFlush();
         }
 
         static int64_t clapwrite(const clap_ostream *s, const void *buffer, uint64_t size)
         {
             auto ofs = static_cast<std::ofstream *>(s->ctx);
             ofs->write((const char *)buffer, size);
-            return size;
+            return ofs->good() ? (int64_t)size : -1;
         }
 
         static int64_t clapread(const struct clap_istream *s, void *buffer, uint64_t size)
         {
             auto ifs = static_cast<std::ifstream *>(s->ctx);
 
-            // Oh this API is so terrible. I think this is right?
+            // a short read at the end of the file sets failbit as well as eofbit
             ifs->read(static_cast<char *>(buffer), size);
-            if (ifs->rdstate() == std::ios::goodbit || ifs->rdstate() == std::ios::eofbit)
-                return ifs->gcount();
-
-            if (ifs->rdstate() & std::ios::eofbit)
+            if (ifs->good() || ifs->eof())
                 return ifs->gcount();
-
             return -1;
         }
 
+        ClapBaseClass<T, TConfig> &cp;
+
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::pair<Op, std::filesystem::path>> requests;
+        bool stopping{false};
+
+        std::atomic<PreparedState *> loaded{nullptr};
+        sst::cpputils::SimpleRingBuffer<PreparedState *, 16> retired;
+        std::mutex retiredMutex;
+
+        // audio thread only
+        PreparedState *swapping{nullptr};
+        uint32_t fadeOutLeft{0}, fadeInPos{fadeSamples}, fadeHold{0};
     } patchIOHandler;
 
+    struct PatchSwapScope
+    {
+        PatchSwapScope(ClapBaseClass<T, TConfig> &h, const clap_process *p) : cp(h), process(p)
+        {
+            cp.patchIOHandler.beginBlock(process);
+        }
+        ~PatchSwapScope() { cp.patchIOHandler.endBlock(process); }
+        PatchSwapScope(const PatchSwapScope &) = delete;
+        PatchSwapScope &operator=(const PatchSwapScope &) = delete;
+
+      private:
+        ClapBaseClass<T, TConfig> &cp;
+        const clap_process *process;
+    };
+
     enum OnMainAction
     {
         RESCAN = 1
@@ -671,6 +1132,7 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
             _host.paramsRescan(CLAP_PARAM_RESCAN_VALUES | CLAP_PARAM_RESCAN_TEXT);
         }
         onMainAction = 0;
+        patchIOHandler.releaseRetired();
         Plugin::onMainThread();
     }
 
@@ -695,13 +1157,12 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
         // todo make this std optional I guess
         ParamDesc getParameterDescription(uint32_t id) const
         {
-            // const so [] isn't an option
-            auto fp = cp.paramDescriptionMap.find(id);
-            if (fp == cp.paramDescriptionMap.end())
+            auto idx = cp.paramIndexOf(id);
+            if (idx < 0)
             {
                 return ParamDesc();
             }
-            return fp->second;
+            return cp.paramDescriptions[idx];
         }
 
         std::vector<ParamDesc> getAllParamDescriptions() const
@@ -720,6 +1181,16 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
 
         std::filesystem::path getDocumentsPath() const { return cp.documentsPath; }
 
+        // Patch files go to the patch io thread; see PatchIOHandler
+        void loadPatch(const std::filesystem::path &p) const
+        {
+            cp.patchIOHandler.enqueueOperation(PatchIOHandler::LOAD, p);
+        }
+        void savePatch(const std::filesystem::path &p) const
+        {
+            cp.patchIOHandler.enqueueOperation(PatchIOHandler::SAVE, p);
+        }
+
       private:
         // Used to be const but I want to save and load from the UI thread
         // so make it private and only do that internally
@@ -745,26 +1216,24 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
 
     void doValueUpdate(clap_id id, float value)
     {
-        auto ptpi = paramToPatchIndex.find(id);
-        if (ptpi == paramToPatchIndex.end())
+        int index = paramIndexOf(id);
+        if (index < 0)
             return;
 
-        int index = ptpi->second;
         patch.params[index] = value;
         if (TConfig::baseClassProvidesMonoModSupport)
         {
             monoModulatedPatch.update(index, patch);
         }
-        auto ptl = paramToLag.find(id);
-        if (ptl != paramToLag.end())
+        if (auto lag = lagByIndex[index])
         {
             if (TConfig::baseClassProvidesMonoModSupport)
             {
-                ptl->second->newValue(monoModulatedPatch.values[index]);
+                lag->newValue(monoModulatedPatch.values[index]);
             }
             else
             {
-                ptl->second->newValue(value);
+                lag->newValue(value);
             }
         }
     }
@@ -772,19 +1241,17 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
     void doMonoModulationUpdate(clap_id id, float value)
     {
         assert(TConfig::baseClassProvidesMonoModSupport);
-        auto ptpi = paramToPatchIndex.find(id);
-        if (ptpi == paramToPatchIndex.end())
+        int index = paramIndexOf(id);
+        if (index < 0)
             return;
 
-        int index = ptpi->second;
         monoModulatedPatch.modulations[index] = value;
         monoModulatedPatch.update(index, patch);
         auto val = monoModulatedPatch.values[index];
 
-        auto ptl = paramToLag.find(id);
-        if (ptl != paramToLag.end())
+        if (auto lag = lagByIndex[index])
         {
-            ptl->second->newValue(val);
+            lag->newValue(val);
         }
     }
 
@@ -813,12 +1280,12 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
             CNDOUT << "Refreshing UI" << std::endl;
             uiComms.refreshUIValues = false;
 
-            for (const auto &[k, v] : paramToValue)
+            for (auto i = 0U; i < TConfig::nParams; ++i)
             {
                 auto r = ToUI();
                 r.type = ToUI::PARAM_VALUE;
-                r.id = k;
-                r.value = *v;
+                r.id = paramDescriptions[i].id;
+                r.value = patch.params[i];
                 uiComms.toUiQ.push(r);
             }
         }
@@ -857,14 +1324,6 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
             ov->try_push(ov, &(evt.header));
         }
         break;
-        case FromUI::LOAD_PATCH:
-            // For now just do this. See comment on IO Handler
-            patchIOHandler.enqueueOperation(*this, PatchIOHandler::LOAD, r.strPointer);
-            break;
-        case FromUI::SAVE_PATCH:
-            // For now just do this. See comment on IO Handler
-            patchIOHandler.enqueueOperation(*this, PatchIOHandler::SAVE, r.strPointer);
-            break;
         case FromUI::SPECIALIZED:
             if constexpr (TConfig::usesSpecializedMessages)
             {
@@ -903,6 +1362,84 @@ struct ClapBaseClass : public plugHelper_t, sst::clap_juce_shim::EditorProvider
         return false;
     }
 
+    /*
+     * processEventSliced walks a process block in spans which contain no inbound event
+     * and never cross a boundary of the plugin's internal block of BlockSize samples.
+     * Events due at the start of a span go to onEvent, then onSpan(start, n, blockPos)
+     * handles frames [start, start + n) where blockPos is the position within the
+     * internal block at start. blockPos persists across calls so blocks can straddle
+     * host buffers.
+     *
+     * This way the inner loops run over contiguous spans without a per-sample event check.
+     */
+    template <uint32_t BlockSize, typename OnEvent, typename OnSpan>
+    void processEventSliced(const clap_process *process, uint32_t &blockPos, OnEvent &&onEvent,
+                            OnSpan &&onSpan)
+    {
+        auto ev = process->in_events;
+        auto sz = ev->size(ev);
+        auto frames = process->frames_count;
+
+        uint32_t nextEventIndex{0};
+        const clap_event_header_t *nextEvent{sz > 0 ? ev->get(ev, 0) : nullptr};
+        auto advance = [&]() {
+            onEvent(nextEvent);
+            nextEventIndex++;
+            nextEvent = nextEventIndex < sz ? ev->get(ev, nextEventIndex) : nullptr;
+        };
+
+        uint32_t s{0};
+        while (s < frames)
+        {
+            while (nextEvent && nextEvent->time <= s)
+                advance();
+
+            auto end = nextEvent ? std::min(nextEvent->time, frames) : frames;
+            if constexpr (BlockSize > 0)
+            {
+                assert(blockPos < BlockSize);
+                end = std::min(end, s + BlockSize - blockPos);
+            }
+
+            onSpan(s, end - s, blockPos);
+
+            if constexpr (BlockSize > 0)
+            {
+                blockPos = (blockPos + end - s) % BlockSize;
+            }
+            s = end;
+        }
+
+        // A misbehaving host can stamp events past the end of the block; apply them anyway
+        while (nextEvent)
+            advance();
+    }
+
+    // For plugins with no internal block; onSpan(start, n) sees the spans between events
+    template <typename OnEvent, typename OnSpan>
+    void processEventSliced(const clap_process *process, OnEvent &&onEvent, OnSpan &&onSpan)
+    {
+        uint32_t unusedBlockPos{0};
+        processEventSliced<0>(
+            process, unusedBlockPos, std::forward<OnEvent>(onEvent),
+            [&onSpan](uint32_t start, uint32_t n, uint32_t) { onSpan(start, n); });
+    }
+
+    /*
+     * Plugins which ring on after their input override implementsTail and call
+     * reportTail from process whenever their tail length moves, which lets the host know.
+     * Those with a sleep fast path keep tail up to date from process too; the patch swap
+     * reads tail.asleep to know their output has gone silent.
+     */
+    sst::conduit::shared::TailTracker tail;
+    std::atomic<uint32_t> tailSamples{0};
+    uint32_t tailGet() const noexcept override { return tailSamples; }
+    void reportTail(uint32_t t)
+    {
+        if (tailSamples.exchange(t) != t && _host.canUseTail())
+            _host.tailChanged();
+    }
+
     void updateParamInPatch(const clap_event_param_value *v)
     {
         doValueUpdate(v->param_id, v->value);
@@ -544,8 +544,6 @@ juce::Typeface::Ptr EditorBase<Content>::loadFont(const std::string &path)
 
 template <typename Content> void Background<Content>::loadsave(bool doSave)
 {
-    using FromUI = typename Content::UICommunicationBundle::UIToSynth_Queue_t::value_type;
-
     auto dp = eb.uic.getDocumentsPath();
     if (doSave)
     {
@@ -560,12 +558,7 @@ template <typename Content> void Background<Content>::loadsave(bool doSave)
             {
                 auto file{chooser.getResult()};
 
-                std::string s = file.getFullPathName().toStdString();
-                FromUI sv;
-                sv.type = FromUI::MType::SAVE_PATCH;
-                sv.strPointer = (char *)malloc(s.size() + 1);
-                strncpy(sv.strPointer, s.c_str(), s.size() + 1);
-                this->eb.uic.fromUiQ.push(sv);
+                this->eb.uic.savePatch(file.getFullPathName().toStdString());
             }
         });
     }
@@ -582,12 +575,7 @@ template <typename Content> void Background<Content>::loadsave(bool doSave)
             {
                 auto file{chooser.getResult()};
 
-                std::string s = file.getFullPathName().toStdString();
-                FromUI sv;
-                sv.type = FromUI::MType::LOAD_PATCH;
-                sv.strPointer = (char *)malloc(s.size() + 1);
-                strncpy(sv.strPointer, s.c_str(), s.size() + 1);
-                this->eb.uic.fromUiQ.push(sv);
+                this->eb.uic.loadPatch(file.getFullPathName().toStdString());
             }
         });
     }
@@ -0,0 +1,140 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+
+#include "mts-tuning.h"
+
+#include <cmath>
+#include <mutex>
+
+#include "libMTSClient.h"
+
+namespace sst::conduit::shared
+{
+namespace
+{
+/*
+ * The process wide registration. Instances hold it through a shared_ptr, and the last one
+ * to go deregisters; the next instance registers again. Only construction and destruction
+ * come through here, on the main thread, so the lock never meets the audio thread.
+ */
+std::shared_ptr<MTSClient> acquireClient()
+{
+    static std::mutex lock;
+    static std::weak_ptr<MTSClient> shared;
+
+    std::lock_guard<std::mutex> g(lock);
+    auto res = shared.lock();
+    if (!res)
+    {
+        auto c = MTS_RegisterClient();
+        if (!c)
+            return nullptr;
+        res = std::shared_ptr<MTSClient>(c, [](MTSClient *cl) { MTS_DeregisterClient(cl); });
+        shared = res;
+    }
+    return res;
+}
+
+float equalTemperament(int key) { return 440.f * std::pow(2.f, (key - 69) / 12.f); }
+} // namespace
+
+MTSTuningSnapshot::MTSTuningSnapshot() : mtsClient(acquireClient())
+{
+    resetToEqualTemperament();
+    refresh();
+}
+
+MTSTuningSnapshot::~MTSTuningSnapshot() = default;
+
+void MTSTuningSnapshot::resetToEqualTemperament()
+{
+    for (int r = 0; r <= nChannels; ++r)
+    {
+        for (int k = 0; k < nKeys; ++k)
+        {
+            freqs[r][k] = equalTemperament(k);
+            retunings[r][k] = 0.f;
+        }
+    }
+}
+
+bool MTSTuningSnapshot::pollRow(int r)
+{
+    auto ch = (char)(r == anyChannel ? -1 : r);
+    bool changed{false};
+    for (int k = 0; k < nKeys; ++k)
+    {
+        auto f = (float)MTS_NoteToFrequency(mtsClient.get(), (char)k, ch);
+        if (f == freqs[r][k])
+            continue;
+        changed = true;
+        freqs[r][k] = f;
+        // the same semitones MTS_RetuningInSemitones gives, without a second round trip
+        retunings[r][k] = 12.f * std::log2(f / equalTemperament(k));
+    }
+    return changed;
+}
+
+bool MTSTuningSnapshot::refresh()
+{
+    auto hasMaster = mtsClient && MTS_HasMaster(mtsClient.get());
+    auto changed = hasMaster != master;
+    master = hasMaster;
+
+    if (!master)
+    {
+        if (changed)
+        {
+            resetToEqualTemperament();
+            gen++;
+        }
+        return changed;
+    }
+
+    changed = pollRow(anyChannel) || changed;
+    for (int c = 0; c < nChannels; ++c)
+    {
+        if (watchedChannels & (1U << c))
+            changed = pollRow(c) || changed;
+    }
+
+    if (changed)
+        gen++;
+    return changed;
+}
+
+void MTSTuningSnapshot::watchChannel(int channel)
+{
+    auto r = row(channel);
+    if (r == anyChannel || (watchedChannels & (1U << r)))
+        return;
+
+    // Fill the row now so a first note on the channel doesn't play a block out of tune.
+    // The channel stops reading the shared row, so anything tuned from that is stale too
+    watchedChannels |= 1U << r;
+    if (master)
+    {
+        pollRow(r);
+        gen++;
+    }
+}
+} // namespace sst::conduit::shared
@@ -0,0 +1,100 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_MTS_TUNING_H
+#define CONDUIT_SRC_CONDUIT_SHARED_MTS_TUNING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+struct MTSClient;
+
+namespace sst::conduit::shared
+{
+/*
+ * A copy of the MTS-ESP master's tuning which the audio thread reads instead of asking
+ * the client per note. refresh polls the client once per process call and bumps
+ * generation() if anything moved, so a consumer which remembers the generation it last
+ * acted on can skip its retuning work entirely while the scale is static.
+ *
+ * The table is 16 channels by 128 keys, plus a row for notes on no particular channel.
+ * Polling all of it every block would be 2176 calls into the client, so a channel row
+ * is only polled once something plays on it; watchChannel marks it. Without a master
+ * the table holds 12-TET at A440 and the retuning is zero.
+ *
+ * All instances in the process share one registration with the master, but each keeps
+ * its own table since instances may process on different threads at once.
+ */
+struct MTSTuningSnapshot
+{
+    static constexpr int nChannels{16}, nKeys{128};
+
+    MTSTuningSnapshot();
+    ~MTSTuningSnapshot();
+    MTSTuningSnapshot(const MTSTuningSnapshot &) = delete;
+    MTSTuningSnapshot &operator=(const MTSTuningSnapshot &) = delete;
+
+    // Once per process call. Returns true if the generation moved
+    bool refresh();
+
+    // Start polling a channel's row. A channel outside 0..15 uses the row for no channel
+    void watchChannel(int channel);
+
+    bool hasMaster() const { return master; }
+    uint32_t generation() const { return gen; }
+    float frequency(int key, int channel) const { return freqs[readRow(channel)][keyIndex(key)]; }
+    float retuningInSemitones(int key, int channel) const
+    {
+        return retunings[readRow(channel)][keyIndex(key)];
+    }
+
+    // For the UI, which may ask the client for things like the scale name directly
+    MTSClient *client() const { return mtsClient.get(); }
+
+  private:
+    static constexpr int anyChannel{nChannels};
+
+    static int row(int channel)
+    {
+        return (channel >= 0 && channel < nChannels) ? channel : anyChannel;
+    }
+    // A channel nothing has played on yet reads the shared row
+    int readRow(int channel) const
+    {
+        auto r = row(channel);
+        return (r != anyChannel && (watchedChannels & (1U << r))) ? r : anyChannel;
+    }
+    static int keyIndex(int key) { return std::clamp(key, 0, nKeys - 1); }
+
+    bool pollRow(int r);
+    void resetToEqualTemperament();
+
+    std::shared_ptr<MTSClient> mtsClient;
+    bool master{false};
+    uint32_t gen{0};
+    uint32_t watchedChannels{0};
+    float freqs[nChannels + 1][nKeys]{}, retunings[nChannels + 1][nKeys]{};
+};
+} // namespace sst::conduit::shared
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_MTS_TUNING_H
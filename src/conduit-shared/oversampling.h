@@ -0,0 +1,197 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_OVERSAMPLING_H
+#define CONDUIT_SRC_CONDUIT_SHARED_OVERSAMPLING_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <clap/clap.h>
+
+#include "sst/basic-blocks/params/ParamMetadata.h"
+#include "sst/filters/HalfRateFilter.h"
+
+namespace sst::conduit::shared
+{
+/*
+ * The values of an oversampling parameter. Auto runs at the plugin's usual factor while
+ * it has a stage which can alias, and at 1x when it doesn't or when the host rate is
+ * already high enough that the images land well above anything audible.
+ */
+enum OversamplingMode : uint32_t
+{
+    osAuto = 0,
+    os1x = 1,
+    os2x = 2,
+    os4x = 3,
+    os8x = 4
+};
+
+static constexpr int maxOversamplingLog2{3}, maxOversampling{1 << maxOversamplingLog2};
+static constexpr double oversamplingAutoOffRate{96000.0};
+
+inline int oversamplingFactorLog2(int mode, double sampleRate, bool nonlinearActive,
+                                  int autoFactorLog2 = 1)
+{
+    if (mode <= (int)osAuto || mode > (int)os8x)
+    {
+        if (!nonlinearActive || sampleRate >= oversamplingAutoOffRate)
+            return 0;
+        return autoFactorLog2;
+    }
+    return mode - (int)os1x;
+}
+
+inline sst::basic_blocks::params::ParamMetaData oversamplingParamDesc(uint32_t id,
+                                                                      const std::string &group)
+{
+    return sst::basic_blocks::params::ParamMetaData()
+        .asInt()
+        .withID(id)
+        .withName("Oversampling")
+        .withGroupName(group)
+        .withRange(osAuto, os8x)
+        .withDefault(osAuto)
+        .withFlags(CLAP_PARAM_IS_AUTOMATABLE | CLAP_PARAM_IS_STEPPED)
+        .withUnorderedMapFormatting(
+            {{osAuto, "Auto"}, {os1x, "1x"}, {os2x, "2x"}, {os4x, "4x"}, {os8x, "8x"}});
+}
+
+/*
+ * A stereo up and down sampler running 1x, 2x, 4x or 8x as a cascade of half band
+ * stages, chosen at runtime. The first stage out of the host rate has to be steep, since
+ * it alone separates the audio band from its image; the later ones only need to clear
+ * the gap between the host nyquist and the next image so get a cheaper filter.
+ *
+ * maxBlockOS is the largest oversampled block either direction is handed. Changing the
+ * factor resets the filters, so there is a short discontinuity when it moves.
+ */
+template <int maxBlockOS> struct Oversampler
+{
+    Oversampler()
+        : up{filter_t(6, true), filter_t(4, false), filter_t(4, false)},
+          down{filter_t(6, true), filter_t(4, false), filter_t(4, false)}
+    {
+    }
+
+    int factorLog2() const { return fLog2; }
+    int factor() const { return 1 << fLog2; }
+
+    // A generous bound, in host rate samples, on how long a round trip rings after silence
+    static constexpr int tailSamplesPerStage{32};
+    int tailSamples() const { return fLog2 * tailSamplesPerStage; }
+
+    // returns true if the factor changed, in which case the filters are reset
+    bool setFactorLog2(int f)
+    {
+        f = std::clamp(f, 0, maxOversamplingLog2);
+        if (f == fLog2)
+            return false;
+        fLog2 = f;
+        reset();
+        return true;
+    }
+
+    void reset()
+    {
+        for (auto &f : up)
+            f.reset();
+        for (auto &f : down)
+            f.reset();
+    }
+
+    /*
+     * n host rate samples in, n * factor() out. Each half band stage zero-stuffs and so
+     * loses half the level; we put that back so all factors run at unity gain.
+     */
+    void upsample(float *inL, float *inR, float *outL, float *outR, int n)
+    {
+        assert(n * factor() <= maxBlockOS);
+        if (fLog2 == 0)
+        {
+            copy(inL, inR, outL, outR, n);
+            return;
+        }
+
+        float *srcL = inL, *srcR = inR;
+        for (int s = 0; s < fLog2; ++s)
+        {
+            n <<= 1;
+            auto last = s == fLog2 - 1;
+            auto dL = last ? outL : scratch[s & 1][0];
+            auto dR = last ? outR : scratch[s & 1][1];
+            up[s].process_block_U2(srcL, srcR, dL, dR, n);
+            srcL = dL;
+            srcR = dR;
+        }
+        auto gain = (float)factor();
+        for (int i = 0; i < n; ++i)
+        {
+            outL[i] *= gain;
+            outR[i] *= gain;
+        }
+    }
+
+    // n oversampled samples in, n / factor() host rate samples out. in may be overwritten.
+    void downsample(float *inL, float *inR, float *outL, float *outR, int n)
+    {
+        assert(n <= maxBlockOS && n % factor() == 0);
+        if (fLog2 == 0)
+        {
+            copy(inL, inR, outL, outR, n);
+            return;
+        }
+
+        float *srcL = inL, *srcR = inR;
+        for (int s = fLog2 - 1; s >= 0; --s)
+        {
+            auto last = s == 0;
+            auto dL = last ? outL : scratch[s & 1][0];
+            auto dR = last ? outR : scratch[s & 1][1];
+            down[s].process_block_D2(srcL, srcR, n, dL, dR);
+            n >>= 1;
+            srcL = dL;
+            srcR = dR;
+        }
+    }
+
+  private:
+    using filter_t = sst::filters::HalfRate::HalfRateFilter;
+
+    static void copy(float *inL, float *inR, float *outL, float *outR, int n)
+    {
+        if (inL != outL)
+            memcpy(outL, inL, n * sizeof(float));
+        if (inR != outR)
+            memcpy(outR, inR, n * sizeof(float));
+    }
+
+    int fLog2{0};
+    filter_t up[maxOversamplingLog2], down[maxOversamplingLog2];
+    float scratch alignas(16)[2][2][maxBlockOS / 2];
+};
+} // namespace sst::conduit::shared
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_OVERSAMPLING_H
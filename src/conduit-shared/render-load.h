@@ -0,0 +1,97 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_RENDER_LOAD_H
+#define CONDUIT_SRC_CONDUIT_SHARED_RENDER_LOAD_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+#include <clap/clap.h>
+
+/*
+ * A conduit specific clap extension through which a plugin which adapts to its render
+ * load reports what it has done. Hosts won't know it; conduit-bench asks for it so a run
+ * can show how close to the deadline a plugin got and what it gave up to stay there.
+ */
+static constexpr const char CONDUIT_EXT_RENDER_LOAD[] = "org.surge-synth-team.conduit.render-load";
+
+typedef struct conduit_render_load
+{
+    float load;           // smoothed process time over the real time length of the blocks
+    float peakLoad;       // the highest load since activation
+    uint32_t voicesShed;  // voices ended early to save time, since activation
+    uint32_t unisonCap;   // the unison count new voices are held to, 0 when not capped
+    uint32_t blocksOverLimit;
+} conduit_render_load_t;
+
+typedef struct conduit_plugin_render_load
+{
+    // [thread-safe]
+    bool(CLAP_ABI *get)(const clap_plugin_t *plugin, conduit_render_load_t *load);
+} conduit_plugin_render_load_t;
+
+namespace sst::conduit::shared
+{
+/*
+ * Times a process call against the real time length of its buffer. The load follows a
+ * rise at once and decays over decaySeconds, so a single slow block is enough to act on
+ * but recovery waits until things have been quiet for a while. blockLoad is the last
+ * block alone, for anything which should stop once the overload itself does.
+ */
+struct RenderLoadMeter
+{
+    using clock_t = std::chrono::steady_clock;
+    static constexpr double decaySeconds{0.25};
+
+    void begin() { startTime = clock_t::now(); }
+
+    float end(uint32_t frames, double sampleRate)
+    {
+        auto elapsed = std::chrono::duration<double>(clock_t::now() - startTime).count();
+        auto budget = frames / sampleRate;
+        if (budget <= 0)
+            return load;
+
+        blockLoad = (float)(elapsed / budget);
+        auto decay = (float)std::exp(-budget / decaySeconds);
+        load = std::max(blockLoad, load * decay);
+        peak = std::max(peak, load);
+        return load;
+    }
+
+    void reset()
+    {
+        load = 0.f;
+        blockLoad = 0.f;
+        peak = 0.f;
+    }
+
+    float load{0.f}, blockLoad{0.f}, peak{0.f};
+
+  private:
+    clock_t::time_point startTime;
+};
+} // namespace sst::conduit::shared
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_RENDER_LOAD_H
@@ -0,0 +1,86 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+/*
+ * With CONDUIT_RT_CHECKS on glibc this also catches malloc, calloc, realloc and
+ * pthread_mutex_lock (which is what std::mutex sits on) from the audio thread.
+ *
+ * Interposing libc like this is only well defined in an executable, so this goes in
+ * conduit-bench and never in the plugin modules, which just get the operator new hooks.
+ */
+
+#include "rt-check.h"
+
+#if CONDUIT_RT_CHECKS && defined(__GLIBC__)
+
+#include <atomic>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <pthread.h>
+
+namespace rtc = sst::conduit::shared::rtcheck;
+
+extern "C"
+{
+    extern void *__libc_malloc(size_t);
+    extern void *__libc_calloc(size_t, size_t);
+    extern void *__libc_realloc(void *, size_t);
+
+    void *malloc(size_t sz) noexcept
+    {
+        if (rtc::onAudioThread())
+            rtc::detail::reportViolation("malloc", sz, CONDUIT_RT_CALLER());
+        return __libc_malloc(sz);
+    }
+
+    void *calloc(size_t n, size_t sz) noexcept
+    {
+        if (rtc::onAudioThread())
+            rtc::detail::reportViolation("calloc", n * sz, CONDUIT_RT_CALLER());
+        return __libc_calloc(n, sz);
+    }
+
+    void *realloc(void *p, size_t sz) noexcept
+    {
+        if (rtc::onAudioThread())
+            rtc::detail::reportViolation("realloc", sz, CONDUIT_RT_CALLER());
+        return __libc_realloc(p, sz);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t *m) noexcept
+    {
+        using lock_t = int (*)(pthread_mutex_t *);
+        static std::atomic<lock_t> next{nullptr};
+
+        if (rtc::onAudioThread())
+            rtc::detail::reportViolation("mutex lock", 0, CONDUIT_RT_CALLER());
+
+        auto fn = next.load(std::memory_order_acquire);
+        if (!fn)
+        {
+            fn = reinterpret_cast<lock_t>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+            next.store(fn, std::memory_order_release);
+        }
+        return fn(m);
+    }
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+/*
+ * The replacement global allocation functions behind rt-check.h. A binary gets at most
+ * one copy: conduit-impl carries it when CONDUIT_RT_CHECKS is on, and conduit-bench
+ * compiles it in itself otherwise so it can still count allocations per block.
+ */
+
+#include "rt-check.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if CONDUIT_RT_CHECKS
+#include "debug-helpers.h"
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#include <unistd.h>
+#define CONDUIT_RT_HAS_BACKTRACE 1
+#endif
+#endif
+
+namespace sst::conduit::shared::rtcheck
+{
+static std::atomic<uint64_t> allocations{0}, violations{0};
+
+uint64_t allocationCount() { return allocations.load(std::memory_order_relaxed); }
+uint64_t violationCount() { return violations.load(std::memory_order_relaxed); }
+
+namespace detail
+{
+#if CONDUIT_RT_CHECKS
+// Each call site is printed once; an allocation per block would otherwise flood the log
+static constexpr int maxReportedSites{256};
+static std::atomic<void *> reportedSites[maxReportedSites]{};
+
+static bool firstReportFrom(void *caller)
+{
+    for (auto &s : reportedSites)
+    {
+        auto cur = s.load(std::memory_order_acquire);
+        if (cur == caller)
+            return false;
+        if (!cur && s.compare_exchange_strong(cur, caller, std::memory_order_acq_rel))
+            return true;
+        if (cur == caller)
+            return false;
+    }
+    return false;
+}
+#endif
+
+void reportViolation(const char *what, size_t bytes, void *caller)
+{
+    violations.fetch_add(1, std::memory_order_relaxed);
+#if CONDUIT_RT_CHECKS
+    if (!firstReportFrom(caller))
+        return;
+
+    hookDepth++;
+    CNDOUT << "Audio thread " << what << CNDVAR(bytes) << " called from " << caller << std::endl;
+#if CONDUIT_RT_HAS_BACKTRACE
+    void *frames[32];
+    auto n = backtrace(frames, 32);
+    backtrace_symbols_fd(frames, n, STDOUT_FILENO);
+#endif
+    hookDepth--;
+#endif
+}
+
+static void *allocate(size_t sz, void *caller)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (onAudioThread())
+        reportViolation("operator new", sz, caller);
+
+    // Keep the libc hooks in conduit-bench from counting this one again
+    hookDepth++;
+    auto p = std::malloc(sz ? sz : 1);
+    hookDepth--;
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+static void *allocateAligned(size_t sz, std::align_val_t al, void *caller)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (onAudioThread())
+        reportViolation("aligned operator new", sz, caller);
+
+    auto align = std::max((size_t)al, sizeof(void *));
+    void *p{nullptr};
+    hookDepth++;
+#if defined(_WIN32)
+    p = _aligned_malloc(sz ? sz : 1, align);
+#else
+    if (posix_memalign(&p, align, sz ? sz : 1) != 0)
+        p = nullptr;
+#endif
+    hookDepth--;
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+static void freeAligned(void *p)
+{
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+} // namespace detail
+} // namespace sst::conduit::shared::rtcheck
+
+namespace rtd = sst::conduit::shared::rtcheck::detail;
+
+/*
+ * The array and nothrow forms forward to these in libstdc++ and libc++. Frees are
+ * fine from the audio thread in this project's sense, so aren't reported.
+ */
+void *operator new(size_t sz) { return rtd::allocate(sz, CONDUIT_RT_CALLER()); }
+void *operator new[](size_t sz) { return rtd::allocate(sz, CONDUIT_RT_CALLER()); }
+void *operator new(size_t sz, std::align_val_t al)
+{
+    return rtd::allocateAligned(sz, al, CONDUIT_RT_CALLER());
+}
+void *operator new[](size_t sz, std::align_val_t al)
+{
+    return rtd::allocateAligned(sz, al, CONDUIT_RT_CALLER());
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { rtd::freeAligned(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { rtd::freeAligned(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { rtd::freeAligned(p); }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept { rtd::freeAligned(p); }
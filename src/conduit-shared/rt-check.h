@@ -0,0 +1,85 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_RT_CHECK_H
+#define CONDUIT_SRC_CONDUIT_SHARED_RT_CHECK_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Real time checks. Configure with -DCONDUIT_RT_CHECKS=TRUE and every operator new made
+ * while a thread is inside process() is reported through CNDOUT, with the call site and
+ * (where the platform has one) a backtrace. conduit-bench additionally catches malloc
+ * and pthread mutex locks on glibc; see rt-check-libc.cpp.
+ *
+ * The plugins mark their process() and any helper threads working on its behalf with an
+ * AudioThreadScope. Without CONDUIT_RT_CHECKS the scope is empty and all of this compiles
+ * away.
+ */
+namespace sst::conduit::shared::rtcheck
+{
+namespace detail
+{
+#if CONDUIT_RT_CHECKS
+inline thread_local int audioThreadDepth{0};
+#endif
+// Set while a hook is itself running, so neither it nor the report recurses
+inline thread_local int hookDepth{0};
+
+void reportViolation(const char *what, size_t bytes, void *caller);
+} // namespace detail
+
+#if CONDUIT_RT_CHECKS
+struct AudioThreadScope
+{
+    AudioThreadScope() { detail::audioThreadDepth++; }
+    ~AudioThreadScope() { detail::audioThreadDepth--; }
+    AudioThreadScope(const AudioThreadScope &) = delete;
+    AudioThreadScope &operator=(const AudioThreadScope &) = delete;
+};
+
+inline bool onAudioThread() { return detail::audioThreadDepth > 0 && detail::hookDepth == 0; }
+#else
+struct AudioThreadScope
+{
+    // user provided so an unused scope in a release build doesn't warn
+    AudioThreadScope() {}
+    ~AudioThreadScope() {}
+};
+
+inline bool onAudioThread() { return false; }
+#endif
+
+// operator new calls made by any thread so far; needs rt-check.cpp in the binary
+uint64_t allocationCount();
+// allocations and locks reported on audio threads so far; always 0 without CONDUIT_RT_CHECKS
+uint64_t violationCount();
+} // namespace sst::conduit::shared::rtcheck
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CONDUIT_RT_CALLER() _ReturnAddress()
+#else
+#define CONDUIT_RT_CALLER() __builtin_return_address(0)
+#endif
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_RT_CHECK_H
@@ -0,0 +1,277 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_STATE_CODEC_H
+#define CONDUIT_SRC_CONDUIT_SHARED_STATE_CODEC_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <clap/clap.h>
+
+namespace sst::conduit::shared
+{
+/*
+ * The binary state encoding. A stream is the four bytes of stateMagic, a u32 version and
+ * then chunks until the stream ends. A chunk is a u32 tag, a u32 byte length and that many
+ * bytes, so a reader can skip any tag it doesn't know and a later version can add chunks
+ * which older builds still load around. Numbers are little endian whatever the platform.
+ */
+static constexpr char stateMagic[4]{'C', 'N', 'D', 'B'};
+
+constexpr uint32_t stateChunkTag(char a, char b, char c, char d)
+{
+    return (uint32_t)(uint8_t)a | (uint32_t)(uint8_t)b << 8 | (uint32_t)(uint8_t)c << 16 |
+           (uint32_t)(uint8_t)d << 24;
+}
+static constexpr uint32_t stateChunkPlugin{stateChunkTag('P', 'L', 'U', 'G')};
+static constexpr uint32_t stateChunkParams{stateChunkTag('P', 'A', 'R', 'M')};
+static constexpr uint32_t stateChunkExtension{stateChunkTag('E', 'X', 'T', 'N')};
+
+/*
+ * Writes to a clap_ostream through a small buffer, or appends to a string. Writes never
+ * fail individually; finish flushes and says whether everything got through.
+ */
+struct StateWriter
+{
+    explicit StateWriter(const clap_ostream *s) : stream(s) {}
+    explicit StateWriter(std::string &s) : memory(&s) {}
+    StateWriter(const StateWriter &) = delete;
+    StateWriter &operator=(const StateWriter &) = delete;
+
+    void u32(uint32_t v)
+    {
+        uint8_t b[4];
+        for (int i = 0; i < 4; ++i)
+            b[i] = (uint8_t)(v >> (8 * i));
+        bytes(b, 4);
+    }
+    void i32(int32_t v) { u32((uint32_t)v); }
+    void u64(uint64_t v)
+    {
+        u32((uint32_t)v);
+        u32((uint32_t)(v >> 32));
+    }
+    void f32(float v)
+    {
+        uint32_t b;
+        memcpy(&b, &v, sizeof(b));
+        u32(b);
+    }
+    void string(const std::string &s)
+    {
+        u32((uint32_t)s.size());
+        bytes(s.data(), s.size());
+    }
+
+    void bytes(const void *d, size_t n)
+    {
+        if (memory)
+        {
+            memory->append(static_cast<const char *>(d), n);
+            return;
+        }
+
+        auto c = static_cast<const uint8_t *>(d);
+        while (n > 0)
+        {
+            if (used == bufferSize)
+                flush();
+            auto k = std::min(n, bufferSize - used);
+            memcpy(buffer + used, c, k);
+            used += k;
+            c += k;
+            n -= k;
+        }
+    }
+
+    // body(StateWriter &) returns false to abandon the chunk, which then isn't written
+    template <typename F> bool chunk(uint32_t tag, F &&body)
+    {
+        std::string blob;
+        StateWriter bw(blob);
+        if (!body(bw))
+            return false;
+        u32(tag);
+        u32((uint32_t)blob.size());
+        bytes(blob.data(), blob.size());
+        return true;
+    }
+
+    bool finish()
+    {
+        flush();
+        return good;
+    }
+
+  private:
+    void flush()
+    {
+        auto c = buffer;
+        while (used > 0 && good)
+        {
+            auto r = stream->write(stream, c, used);
+            if (r <= 0)
+                good = false;
+            else
+            {
+                c += r;
+                used -= r;
+            }
+        }
+        used = 0;
+    }
+
+    static constexpr size_t bufferSize{4096};
+    const clap_ostream *stream{nullptr};
+    std::string *memory{nullptr};
+    uint8_t buffer[bufferSize];
+    size_t used{0};
+    bool good{true};
+};
+
+/*
+ * Reads a clap_istream through a small buffer, or a block of memory such as a chunk body.
+ * There is no limit on how much a stream holds. Every read returns false once the data
+ * runs out.
+ */
+struct StateReader
+{
+    explicit StateReader(const clap_istream *s) : stream(s) {}
+    StateReader(const char *d, size_t n) : data(reinterpret_cast<const uint8_t *>(d)), size(n)
+    {
+    }
+    StateReader(const StateReader &) = delete;
+    StateReader &operator=(const StateReader &) = delete;
+
+    bool u32(uint32_t &v)
+    {
+        uint8_t b[4];
+        if (!bytes(b, 4))
+            return false;
+        v = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+        return true;
+    }
+    bool i32(int32_t &v)
+    {
+        uint32_t u;
+        if (!u32(u))
+            return false;
+        v = (int32_t)u;
+        return true;
+    }
+    bool u64(uint64_t &v)
+    {
+        uint32_t lo, hi;
+        if (!u32(lo) || !u32(hi))
+            return false;
+        v = (uint64_t)hi << 32 | lo;
+        return true;
+    }
+    bool f32(float &v)
+    {
+        uint32_t b;
+        if (!u32(b))
+            return false;
+        memcpy(&v, &b, sizeof(v));
+        return true;
+    }
+    bool string(std::string &s)
+    {
+        uint32_t n;
+        return u32(n) && append(s.erase(), n);
+    }
+
+    bool bytes(void *d, size_t n)
+    {
+        auto c = static_cast<uint8_t *>(d);
+        while (n > 0)
+        {
+            if (pos == size && !refill())
+                return false;
+            auto k = std::min(n, size - pos);
+            memcpy(c, data + pos, k);
+            pos += k;
+            c += k;
+            n -= k;
+        }
+        return true;
+    }
+
+    // The next chunk; its body is read a buffer at a time so a bad length just runs out
+    bool chunk(uint32_t &tag, std::string &body)
+    {
+        uint32_t n;
+        return u32(tag) && u32(n) && append(body.erase(), n);
+    }
+
+    bool atEnd() { return pos == size && !refill(); }
+
+    // Everything left in the stream, for the xml reader
+    void readRest(std::string &into)
+    {
+        while (!atEnd())
+        {
+            into.append(reinterpret_cast<const char *>(data + pos), size - pos);
+            pos = size;
+        }
+    }
+
+  private:
+    bool append(std::string &into, size_t n)
+    {
+        while (n > 0)
+        {
+            if (pos == size && !refill())
+                return false;
+            auto k = std::min(n, size - pos);
+            into.append(reinterpret_cast<const char *>(data + pos), k);
+            pos += k;
+            n -= k;
+        }
+        return true;
+    }
+
+    bool refill()
+    {
+        if (!stream)
+            return false;
+        auto r = stream->read(stream, buffer, bufferSize);
+        if (r <= 0)
+            return false;
+        data = buffer;
+        size = (size_t)r;
+        pos = 0;
+        return true;
+    }
+
+    static constexpr size_t bufferSize{4096};
+    const clap_istream *stream{nullptr};
+    const uint8_t *data{nullptr};
+    size_t size{0}, pos{0};
+    uint8_t buffer[bufferSize];
+};
+} // namespace sst::conduit::shared
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_STATE_CODEC_H
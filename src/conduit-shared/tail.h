@@ -0,0 +1,86 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_TAIL_H
+#define CONDUIT_SRC_CONDUIT_SHARED_TAIL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <clap/clap.h>
+
+namespace sst::conduit::shared
+{
+// Anything quieter than this, about -120 dBFS, counts as silence when deciding to sleep
+static constexpr float silenceThreshold{1e-6f};
+// clap reads a tail at or past INT32_MAX as infinite
+static constexpr uint32_t infiniteTail{INT32_MAX};
+
+inline float bufferPeak(const float *d, uint32_t n)
+{
+    float res{0.f};
+    for (auto i = 0U; i < n; ++i)
+        res = std::max(res, std::fabs(d[i]));
+    return res;
+}
+
+// A constant channel only needs its first sample looked at
+inline bool audioBufferIsSilent(const clap_audio_buffer_t &b, uint32_t frames)
+{
+    if (!b.data32)
+        return false;
+    for (auto c = 0U; c < b.channel_count; ++c)
+    {
+        auto n = (b.constant_mask & (1ULL << c)) ? std::min(frames, 1U) : frames;
+        if (bufferPeak(b.data32[c], n) >= silenceThreshold)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * Decides when a plugin may sleep. Each process reports whether nothing audible went
+ * into the dsp, and how long the dsp can keep ringing once that's so. Once the quiet
+ * has lasted that long, and the last output was itself silent, the plugin is asleep:
+ * it can return CLAP_PROCESS_SLEEP and, while the input stays silent, skip its dsp and
+ * write zeros. Anything going in wakes it.
+ */
+struct TailTracker
+{
+    void update(bool quietIn, bool quietOut, uint32_t frames, uint32_t tail)
+    {
+        quietSamples = quietIn ? std::min<uint64_t>(quietSamples + frames, infiniteTail) : 0;
+        asleep = quietIn && quietOut && tail < infiniteTail && quietSamples >= tail;
+    }
+
+    void wake()
+    {
+        quietSamples = 0;
+        asleep = false;
+    }
+
+    bool asleep{false};
+    uint64_t quietSamples{0};
+};
+} // namespace sst::conduit::shared
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_TAIL_H
@@ -0,0 +1,268 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_TASK_POOL_H
+#define CONDUIT_SRC_CONDUIT_SHARED_TASK_POOL_H
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "rt-check.h"
+#include "sse-include.h"
+
+namespace sst::conduit::shared
+{
+/*
+ * TaskPool is a fixed set of worker threads which help the audio thread through a
+ * batch of independent tasks, for hosts which don't offer the CLAP thread-pool
+ * extension. run(n, f) calls f(0) ... f(n-1) and returns once all of them are done.
+ *
+ * Tasks are handed out through a single atomic claim word which the workers and the
+ * calling thread all claim from, so the caller never blocks on a worker waking up;
+ * if none do it just runs the whole batch itself. Nothing in run allocates or locks.
+ * The word holds the batch number and size as well as the next index, so a claim is
+ * only ever granted against the batch it was made for; a worker which stalls past the
+ * end of one batch fails its claim rather than taking a task of the next.
+ * Workers spin for a little while after a batch, since the next one is usually a
+ * block away, and then sleep.
+ */
+struct TaskPool
+{
+    explicit TaskPool(int nWorkers)
+    {
+        workers.reserve(nWorkers);
+        for (int i = 0; i < nWorkers; ++i)
+            workers.emplace_back([this]() { workerLoop(); });
+    }
+
+    ~TaskPool()
+    {
+        {
+            std::lock_guard<std::mutex> g(sleepMutex);
+            stopping = true;
+        }
+        sleepCV.notify_all();
+        for (auto &w : workers)
+            w.join();
+    }
+
+    TaskPool(const TaskPool &) = delete;
+    TaskPool &operator=(const TaskPool &) = delete;
+
+    size_t workerCount() const { return workers.size(); }
+
+    static constexpr uint32_t maxTasks{0xFFFF};
+
+    template <typename F> void run(uint32_t nTasks, F &&f)
+    {
+        assert(nTasks <= maxTasks);
+        using fn_t = std::remove_reference_t<F>;
+        taskCtx = (void *)&f;
+        taskFn = [](void *ctx, uint32_t idx) { (*static_cast<fn_t *>(ctx))(idx); };
+        doneTasks.store(0, std::memory_order_relaxed);
+        // Publishes fn and ctx with the batch; a claim made against this word acquires them
+        auto gen = generation.load(std::memory_order_relaxed) + 1;
+        claim.store(gen << 32 | (uint64_t)nTasks << 16, std::memory_order_release);
+        generation.store(gen, std::memory_order_release);
+        if (sleepingWorkers.load(std::memory_order_acquire) > 0)
+            sleepCV.notify_all();
+
+        drain();
+        while (doneTasks.load(std::memory_order_acquire) < nTasks)
+            _mm_pause();
+    }
+
+  private:
+    static constexpr int spinsBeforeSleep{1 << 16};
+
+    /*
+     * Claims are gen << 32 | count << 16 | next index. A successful claim means the batch
+     * was still current when we took the index, and run can't move on until we report it
+     * done, so taskFn and taskCtx are still that batch's while the task runs.
+     */
+    void drain()
+    {
+        auto w = claim.load(std::memory_order_acquire);
+        while (true)
+        {
+            auto idx = (uint32_t)(w & 0xFFFF);
+            auto count = (uint32_t)((w >> 16) & 0xFFFF);
+            if (idx >= count)
+                return;
+            if (!claim.compare_exchange_weak(w, w + 1, std::memory_order_acq_rel,
+                                             std::memory_order_acquire))
+                continue;
+            taskFn(taskCtx, idx);
+            doneTasks.fetch_add(1, std::memory_order_release);
+            w = claim.load(std::memory_order_acquire);
+        }
+    }
+
+    void workerLoop()
+    {
+        // Match what hosts set on the audio thread so voice code doesn't hit denormals
+        _mm_setcsr(_mm_getcsr() | 0x8040);
+
+        uint64_t seen{0};
+        while (true)
+        {
+            int spins{0};
+            while (generation.load(std::memory_order_acquire) == seen && !stopping)
+            {
+                if (spins++ < spinsBeforeSleep)
+                {
+                    _mm_pause();
+                    continue;
+                }
+                std::unique_lock<std::mutex> lg(sleepMutex);
+                sleepingWorkers++;
+                // run() notifies without the lock, so bound the wait rather than trust it
+                sleepCV.wait_for(lg, std::chrono::milliseconds(1), [&]() {
+                    return stopping || generation.load(std::memory_order_acquire) != seen;
+                });
+                sleepingWorkers--;
+            }
+            if (stopping)
+                return;
+
+            seen = generation.load(std::memory_order_acquire);
+            rtcheck::AudioThreadScope rtScope;
+            drain();
+        }
+    }
+
+    std::vector<std::thread> workers;
+
+    void (*taskFn)(void *, uint32_t){nullptr};
+    void *taskCtx{nullptr};
+    std::atomic<uint32_t> doneTasks{0};
+    std::atomic<uint64_t> claim{0}, generation{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+    std::atomic<int> sleepingWorkers{0};
+    std::atomic<bool> stopping{false};
+};
+
+/*
+ * PipelineWorker runs one job at a time on a thread of its own, for work which overlaps
+ * the caller's next block rather than being shared out with it. launch(f, ctx) hands the
+ * job over and returns at once; join() waits for it to finish, and launch joins any job
+ * still running first. As with TaskPool nothing here allocates or locks on the calling
+ * side, and the worker spins for a while after a job before it sleeps.
+ */
+struct PipelineWorker
+{
+    PipelineWorker() { worker = std::thread([this]() { workerLoop(); }); }
+
+    ~PipelineWorker()
+    {
+        join();
+        {
+            std::lock_guard<std::mutex> g(sleepMutex);
+            stopping = true;
+        }
+        sleepCV.notify_all();
+        worker.join();
+    }
+
+    PipelineWorker(const PipelineWorker &) = delete;
+    PipelineWorker &operator=(const PipelineWorker &) = delete;
+
+    void launch(void (*fn)(void *), void *ctx)
+    {
+        join();
+        jobFn = fn;
+        jobCtx = ctx;
+        pending = true;
+        launched.fetch_add(1, std::memory_order_release);
+        if (sleeping.load(std::memory_order_acquire))
+            sleepCV.notify_all();
+    }
+
+    void join()
+    {
+        if (!pending)
+            return;
+        auto target = launched.load(std::memory_order_relaxed);
+        while (finished.load(std::memory_order_acquire) != target)
+            _mm_pause();
+        pending = false;
+    }
+
+  private:
+    static constexpr int spinsBeforeSleep{1 << 16};
+
+    void workerLoop()
+    {
+        _mm_setcsr(_mm_getcsr() | 0x8040);
+
+        uint64_t seen{0};
+        while (true)
+        {
+            int spins{0};
+            while (launched.load(std::memory_order_acquire) == seen && !stopping)
+            {
+                if (spins++ < spinsBeforeSleep)
+                {
+                    _mm_pause();
+                    continue;
+                }
+                std::unique_lock<std::mutex> lg(sleepMutex);
+                sleeping = true;
+                sleepCV.wait_for(lg, std::chrono::milliseconds(1), [&]() {
+                    return stopping || launched.load(std::memory_order_acquire) != seen;
+                });
+                sleeping = false;
+            }
+            if (stopping)
+                return;
+
+            seen = launched.load(std::memory_order_acquire);
+            {
+                rtcheck::AudioThreadScope rtScope;
+                jobFn(jobCtx);
+            }
+            finished.store(seen, std::memory_order_release);
+        }
+    }
+
+    std::thread worker;
+
+    void (*jobFn)(void *){nullptr};
+    void *jobCtx{nullptr};
+    bool pending{false}; // only touched by the calling thread
+    std::atomic<uint64_t> launched{0}, finished{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+    std::atomic<bool> sleeping{false}, stopping{false};
+};
+} // namespace sst::conduit::shared
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_TASK_POOL_H
@@ -0,0 +1,129 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+
+#ifndef CONDUIT_SRC_CONDUIT_SHARED_TELEMETRY_H
+#define CONDUIT_SRC_CONDUIT_SHARED_TELEMETRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include <clap/clap.h>
+
+#include "sse-include.h"
+
+namespace sst::conduit::shared
+{
+/*
+ * Telemetry<T> carries a block of values from the audio thread to anyone else who wants
+ * to look: the editor, or an extension a host may call from any thread. The audio thread
+ * updates live as it goes, so counters carry on from block to block, and calls publish
+ * once per process. Readers take a whole consistent copy with read.
+ *
+ * It is a seqlock. The sequence is odd while a publish is under way, and a reader which
+ * sees it odd, or sees it move while copying, copies again. The payload is held as
+ * relaxed atomic words so the racing copy is well defined; on the platforms we build for
+ * those are plain loads and stores. The published copy starts a cache line and the type
+ * is line aligned, so it shares no line with live or with whatever the plugin keeps
+ * around it.
+ */
+template <typename T> struct Telemetry
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    // [audio-thread] the working copy
+    T live{};
+
+    // [audio-thread]
+    void publish()
+    {
+        uint64_t buf[nWords]{};
+        memcpy(buf, &live, sizeof(T));
+
+        auto s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (int i = 0; i < nWords; ++i)
+            words[i].store(buf[i], std::memory_order_relaxed);
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    // [thread-safe] the last published copy; it counts up by one per publish
+    uint64_t version() const { return sequence.load(std::memory_order_acquire) >> 1; }
+
+    // [thread-safe]
+    T read() const
+    {
+        uint64_t buf[nWords];
+        while (true)
+        {
+            auto s = sequence.load(std::memory_order_acquire);
+            if (s & 1)
+            {
+                _mm_pause();
+                continue;
+            }
+            for (int i = 0; i < nWords; ++i)
+                buf[i] = words[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == s)
+                break;
+        }
+        T res;
+        memcpy(&res, buf, sizeof(T));
+        return res;
+    }
+
+  private:
+    static constexpr int nWords{(int)((sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t))};
+    alignas(64) std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> words[nWords]{};
+};
+
+// The host transport as the editors show it
+struct TransportTelemetry
+{
+    bool isPlayingOrRecording{false};
+    double tempo{0};
+    clap_beattime bar_start{0};
+    int32_t bar_number{0};
+    clap_beattime song_pos_beats{0};
+    uint16_t tsig_num{0}, tsig_denom{0};
+
+    void update(const clap_event_transport_t *tev)
+    {
+        if (!tev)
+            return;
+        tempo = tev->tempo;
+        bar_start = tev->bar_start;
+        bar_number = tev->bar_number;
+        song_pos_beats = tev->song_pos_beats;
+        tsig_num = tev->tsig_num;
+        tsig_denom = tev->tsig_denom;
+        isPlayingOrRecording =
+            (tev->flags & CLAP_TRANSPORT_IS_PLAYING) || (tev->flags & CLAP_TRANSPORT_IS_RECORDING);
+    }
+};
+} // namespace sst::conduit::shared
+
+#endif // CONDUIT_SRC_CONDUIT_SHARED_TELEMETRY_H
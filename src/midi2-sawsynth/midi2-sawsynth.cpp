@@ -116,6 +116,9 @@ bool ConduitMIDI2SawSynth::notePortsInfo(uint32_t index, bool isInput,
 
 clap_process_status ConduitMIDI2SawSynth::process(const clap_process *process) noexcept
 {
+    shared::rtcheck::AudioThreadScope rtScope;
+    PatchSwapScope patchSwap{*this, process};
+
     auto ev = process->in_events;
     auto sz = ev->size(ev);
 
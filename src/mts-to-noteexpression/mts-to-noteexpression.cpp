@@ -23,8 +23,6 @@
 #include "juce_gui_basics/juce_gui_basics.h"
 #include "version.h"
 
-#include "libMTSClient.h"
-
 namespace sst::conduit::mts_to_noteexpression
 {
 const clap_plugin_descriptor *ConduitMTSToNoteExpressionConfig::getDescription()
@@ -48,8 +46,6 @@ ConduitMTSToNoteExpression::ConduitMTSToNoteExpression(const clap_host *host)
     : sst::conduit::shared::ClapBaseClass<ConduitMTSToNoteExpression,
                                           ConduitMTSToNoteExpressionConfig>(host)
 {
-    mtsClient = MTS_RegisterClient();
-
     auto autoFlag = CLAP_PARAM_IS_AUTOMATABLE;
     auto steppedFlag = autoFlag | CLAP_PARAM_IS_STEPPED;
 
@@ -78,7 +74,7 @@ ConduitMTSToNoteExpression::ConduitMTSToNoteExpression(const clap_host *host)
     clapJuceShim = std::make_unique<sst::clap_juce_shim::ClapJuceShim>(this);
     clapJuceShim->setResizable(true);
 
-    uiComms.dataCopyForUI.mtsClient = mtsClient;
+    uiComms.dataCopyForUI.mtsClient = tuning.client();
 }
 
 ConduitMTSToNoteExpression::~ConduitMTSToNoteExpression() {}
@@ -96,7 +92,7 @@ bool ConduitMTSToNoteExpression::notePortsInfo(uint32_t index, bool isInput,
 
 float ConduitMTSToNoteExpression::retuningFor(int key, int channel) const
 {
-    return MTS_RetuningInSemitones(mtsClient, key, channel);
+    return tuning.retuningInSemitones(key, channel);
 }
 
 bool ConduitMTSToNoteExpression::tuningActive() { return true; }
@@ -104,16 +100,23 @@ bool ConduitMTSToNoteExpression::retuneHeldNotes() { return (*retunHeld > 0.5);
 
 clap_process_status ConduitMTSToNoteExpression::process(const clap_process *process) noexcept
 {
+    shared::rtcheck::AudioThreadScope rtScope;
+    PatchSwapScope patchSwap{*this, process};
+
     auto ev = process->in_events;
     auto ov = process->out_events;
     auto sz = ev->size(ev);
 
-    // Generate top-of-block tuning messages for all our notes that are on
-    for (int c = 0; c < 16; ++c)
+    // Generate top-of-block tuning messages for all our notes that are on, if the tuning moved
+    tuning.refresh();
+    auto rescan = tuningActive() && retuneHeldNotes() && tuning.generation() != retunedGeneration;
+    if (rescan)
+        retunedGeneration = tuning.generation();
+    for (int c = 0; c < 16 && rescan; ++c)
     {
         for (int i = 0; i < 128; ++i)
         {
-            if (tuningActive() && noteRemaining[c][i] != 0.f && retuneHeldNotes())
+            if (noteRemaining[c][i] != 0.f)
             {
                 auto prior = sclTuning[c][i];
                 sclTuning[c][i] = retuningFor(i, c);
@@ -173,6 +176,7 @@ clap_process_status ConduitMTSToNoteExpression::process(const clap_process *proc
             assert(nevt->key >= 0);
             assert(nevt->key < 128);
             noteRemaining[nevt->channel][nevt->key] = -1;
+            tuning.watchChannel(nevt->channel);
 
             auto q = clap_event_note_expression();
             q.header.size = sizeof(clap_event_note_expression);
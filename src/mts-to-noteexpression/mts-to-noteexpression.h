@@ -33,6 +33,7 @@
 #include "sst/cpputils/ring_buffer.h"
 
 #include "conduit-shared/clap-base-class.h"
+#include "conduit-shared/mts-tuning.h"
 
 struct MTSClient;
 
@@ -110,7 +111,12 @@ struct ConduitMTSToNoteExpression
 
     typedef std::unordered_map<int, int> PatchPluginExtension;
 
-    MTSClient *mtsClient{nullptr};
+    /*
+     * The master's retuning as of this process call. Held notes are only rescanned when
+     * its generation moves, so a static scale costs nothing per block.
+     */
+    sst::conduit::shared::MTSTuningSnapshot tuning;
+    uint32_t retunedGeneration{0};
     char priorScaleName[CLAP_NAME_SIZE];
     std::array<std::array<float, 128>, 16>
         noteRemaining{}; // -1 means still held, otherwise its the time
@@ -135,47 +135,35 @@ bool ConduitMultiOutSynth::notePortsInfo(uint32_t index, bool isInput,
 
 clap_process_status ConduitMultiOutSynth::process(const clap_process *process) noexcept
 {
-    auto ev = process->in_events;
-    auto sz = ev->size(ev);
+    shared::rtcheck::AudioThreadScope rtScope;
+    PatchSwapScope patchSwap{*this, process};
 
-    // This pointer is the sentinel to our next event which we advance once an event is processed
-    const clap_event_header_t *nextEvent{nullptr};
-    uint32_t nextEventIndex{0};
-    if (sz != 0)
-    {
-        nextEvent = ev->get(ev, nextEventIndex);
-    }
-
-    for (auto s = 0U; s < process->frames_count; ++s)
-    {
-        while (nextEvent && nextEvent->time == s)
-        {
-            handleParamBaseEvents(nextEvent);
-            nextEventIndex++;
-            if (nextEventIndex >= sz)
-                nextEvent = nullptr;
-            else
-                nextEvent = ev->get(ev, nextEventIndex);
-        }
-
-        for (auto &c : chans)
-        {
-            c.env.process(0.0, 0.1, 0.1, 0.1, 0, 0, 0, true);
-            c.timeSinceTrigger += sampleRateInv;
-            if (c.timeSinceTrigger > *(c.time))
+    processEventSliced(
+        process, [this](auto *evt) { handleParamBaseEvents(evt); },
+        [&](uint32_t start, uint32_t n) {
+            for (auto &c : chans)
             {
-                c.timeSinceTrigger -= *(c.time);
-                c.env.attackFrom(0, 0.1, 0, true);
-
-                c.osc.setRate(2.0 * M_PI * 440.0 * pow(2.f, (*(c.freq) - 69) / 12) *
-                              dsamplerate_inv);
+                auto *outL = process->audio_outputs[c.chan].data32[0];
+                auto *outR = process->audio_outputs[c.chan].data32[1];
+                for (auto s = start; s < start + n; ++s)
+                {
+                    c.env.process(0.0, 0.1, 0.1, 0.1, 0, 0, 0, true);
+                    c.timeSinceTrigger += sampleRateInv;
+                    if (c.timeSinceTrigger > *(c.time))
+                    {
+                        c.timeSinceTrigger -= *(c.time);
+                        c.env.attackFrom(0, 0.1, 0, true);
+
+                        c.osc.setRate(2.0 * M_PI * 440.0 * pow(2.f, (*(c.freq) - 69) / 12) *
+                                      dsamplerate_inv);
+                    }
+                    auto v = c.env.output * c.osc.u;
+                    c.osc.step();
+                    outL[s] = v;
+                    outR[s] = v;
+                }
             }
-            auto v = c.env.output * c.osc.u;
-            c.osc.step();
-            process->audio_outputs[c.chan].data32[0][s] = v;
-            process->audio_outputs[c.chan].data32[1][s] = v;
-        }
-    }
+        });
 
     return CLAP_PROCESS_CONTINUE;
 }
@@ -64,8 +64,8 @@ struct StatusPanel : juce::Component
             g.setFont(14);
             g.drawText("Tempo", bx, juce::Justification::topLeft);
             bx = bx.translated(0, bx.getHeight());
-            g.drawText(fmt::format("{:.1f} bpm", 1.0 * uic.dataCopyForUI.tempo), bx,
-                       juce::Justification::topLeft);
+            auto tempo = uic.dataCopyForUI.telemetry.read().transport.tempo;
+            g.drawText(fmt::format("{:.1f} bpm", tempo), bx, juce::Justification::topLeft);
         }
     }
 };
@@ -99,8 +99,8 @@ struct TapPanel : jcmp::NamedPanel
         }
         void updateVUMeter(TapPanel *p)
         {
-            vuMeter->setLevels(p->uic.dataCopyForUI.tapVu[p->tapIdx][0],
-                               p->uic.dataCopyForUI.tapVu[p->tapIdx][1]);
+            auto tm = p->uic.dataCopyForUI.telemetry.read();
+            vuMeter->setLevels(tm.tapVu[p->tapIdx][0], tm.tapVu[p->tapIdx][1]);
         }
         sst::jucegui::layouts::LabeledGrid<5, 2> layout;
         std::unordered_map<uint32_t, std::unique_ptr<jcmp::ContinuousParamEditor>> knobs;
@@ -217,6 +217,9 @@ bool ConduitPolymetricDelay::audioPortsInfo(uint32_t index, bool isInput,
 
 clap_process_status ConduitPolymetricDelay::process(const clap_process *process) noexcept
 {
+    shared::rtcheck::AudioThreadScope rtScope;
+    PatchSwapScope patchSwap{*this, process};
+
     while (!uiComms.fromUiQ.empty())
     {
         auto r = *uiComms.fromUiQ.pop();
@@ -244,132 +247,184 @@ clap_process_status ConduitPolymetricDelay::process(const clap_process *process)
     if (chans < 2)
         return CLAP_PROCESS_SLEEP;
 
-    auto ev = process->in_events;
-    auto sz = ev->size(ev);
-
-    // This pointer is the sentinel to our next event which we advance once an event is processed
-    const clap_event_header_t *nextEvent{nullptr};
-    uint32_t nextEventIndex{0};
-    if (sz != 0)
+    if (process->transport)
     {
-        nextEvent = ev->get(ev, nextEventIndex);
+        handleInboundEvent((const clap_event_header *)(process->transport));
     }
 
-    if (process->transport)
+    auto frames = process->frames_count;
+    auto inputSilent = shared::audioBufferIsSilent(process->audio_inputs[0], frames);
+    auto longestTap = longestTapSamples();
+    auto settle = (uint32_t)(filterSettleSeconds * sampleRate);
+    reportTail(feedbackTailSamples(longestTap, settle));
+    if (tail.asleep && longestTap > tail.quietSamples)
+        flushDelayLines(longestTap);
+    if (tail.asleep && inputSilent && process->in_events->size(process->in_events) == 0)
     {
-        handleInboundEvent((const clap_event_header *)(process->transport));
+        for (auto c = 0U; c < ochans; ++c)
+            memset(out[c], 0, frames * sizeof(float));
+        auto &tm = uiComms.dataCopyForUI.telemetry;
+        for (int c = 0; c < 2; ++c)
+        {
+            tm.live.inVu[c] = 0.f;
+            tm.live.outVu[c] = 0.f;
+            for (int t = 0; t < nTaps; ++t)
+                tm.live.tapVu[t][c] = 0.f;
+        }
+        tm.publish();
+        return CLAP_PROCESS_SLEEP;
     }
 
     float inMx[2]{0, 0}, outMx[2]{0, 0}, tapMx[nTaps][2]{};
+    float writeMx{0};
     bool active[nTaps];
     for (int i = 0; i < nTaps; ++i)
     {
         active[i] = *(tapData[i].active) > 0.5;
     }
 
-    for (auto i = 0U; i < process->frames_count; ++i)
-    {
-        while (nextEvent && nextEvent->time == i)
-        {
-            handleInboundEvent(nextEvent);
-            nextEventIndex++;
-            if (nextEventIndex >= sz)
-                nextEvent = nullptr;
-            else
-                nextEvent = ev->get(ev, nextEventIndex);
-        }
-
-        if (slowProcess >= blockSize)
-        {
-            slowProcess = 0;
-            inVU.process(inMx[0], inMx[1]);
-            outVU.process(outMx[0], outMx[1]);
-            inMx[0] = 0;
-            inMx[1] = 0;
-            outMx[0] = 0;
-            outMx[1] = 0;
-
-            for (int t = 0; t < nTaps; ++t)
+    processEventSliced<blockSize>(
+        process, slowProcess, [this](auto *evt) { handleInboundEvent(evt); },
+        [&](uint32_t start, uint32_t n, uint32_t pos) {
+            if (pos == 0)
             {
-                tapOutVU[t].process(tapMx[t][0], tapMx[t][1]);
-
-                tapMx[t][0] = 0;
-                tapMx[t][1] = 0;
-
-                // Recalc pan laws
-                sst::basic_blocks::dsp::pan_laws::stereoEqualPower((*(tapData[t].pan) + 1) * 0.5,
-                                                                   tapPanMatrix[t]);
+                inVU.process(inMx[0], inMx[1]);
+                outVU.process(outMx[0], outMx[1]);
+                inMx[0] = 0;
+                inMx[1] = 0;
+                outMx[0] = 0;
+                outMx[1] = 0;
+
+                for (int t = 0; t < nTaps; ++t)
+                {
+                    tapOutVU[t].process(tapMx[t][0], tapMx[t][1]);
+
+                    tapMx[t][0] = 0;
+                    tapMx[t][1] = 0;
+
+                    // Recalc pan laws
+                    sst::basic_blocks::dsp::pan_laws::stereoEqualPower(
+                        (*(tapData[t].pan) + 1) * 0.5, tapPanMatrix[t]);
+
+                    setTapFilterFrequencies(t);
+                }
+            }
 
-                setTapFilterFrequencies(t);
+            for (auto i = start; i < start + n; ++i)
+            {
+                float totalTapOut[2]{};
+                float totalTapFB[2]{};
+                for (int tap = 0; tap < nTaps; ++tap)
+                {
+                    if (!active[tap])
+                        continue;
+
+                    auto tl = tapData[tap].level.v;
+                    tl = tl * tl * tl;
+                    auto ftl = tapData[tap].fblev.v;
+                    ftl = ftl * ftl * ftl;
+                    auto cftl = tapData[tap].crossfblev.v;
+                    cftl = cftl * cftl * cftl;
+
+                    tapData[tap].modulator.step();
+                    auto tt = baseTapSamples[tap] * (1 + modDepthScale * tapData[tap].moddepth.v *
+                                                             tapData[tap].modulator.u);
+
+                    auto smpL = delayLine[0].read(tt);
+                    auto smpR = delayLine[1].read(tt);
+
+                    auto dL = smpL * tapPanMatrix[tap][0] + smpR * tapPanMatrix[tap][2];
+                    auto dR = smpR * tapPanMatrix[tap][1] + smpL * tapPanMatrix[tap][3];
+
+                    dL = dL * tl;
+                    dR = dR * tl;
+
+                    hp[tap].process_sample(dL, dR, dL, dR);
+                    lp[tap].process_sample(dL, dR, dL, dR);
+
+                    tapMx[tap][0] = std::max(tapMx[tap][0], std::abs(dL));
+                    tapMx[tap][1] = std::max(tapMx[tap][1], std::abs(dR));
+
+                    totalTapOut[0] += dL;
+                    totalTapOut[1] += dR;
+
+                    totalTapFB[0] += smpL * ftl + smpR * cftl;
+                    totalTapFB[1] += smpR * ftl + smpL * cftl;
+                }
+
+                auto dl = (*dryLev);
+                dl = dl * dl * dl;
+                for (auto c = 0U; c < chans; ++c)
+                {
+                    out[c][i] = in[c][i] * dl + totalTapOut[c];
+
+                    auto w = in[c][i] + totalTapFB[c];
+                    delayLine[c].write(w);
+                    writeMx = std::max(writeMx, std::abs(w));
+                    inMx[c] = std::max(inMx[c], std::abs(in[c][i]));
+                    outMx[c] = std::max(outMx[c], std::abs(out[c][i]));
+                }
+
+                processLags();
             }
-        }
-        slowProcess++;
+        });
 
-        float totalTapOut[2]{};
-        float totalTapFB[2]{};
-        for (int tap = 0; tap < nTaps; ++tap)
+    auto &tm = uiComms.dataCopyForUI.telemetry;
+    for (int c = 0; c < 2; ++c)
+    {
+        tm.live.inVu[c] = inVU.vu_peak[c];
+        tm.live.outVu[c] = outVU.vu_peak[c];
+        for (int t = 0; t < nTaps; ++t)
         {
-            if (!active[tap])
-                continue;
-
-            auto tl = tapData[tap].level.v;
-            tl = tl * tl * tl;
-            auto ftl = tapData[tap].fblev.v;
-            ftl = ftl * ftl * ftl;
-            auto cftl = tapData[tap].crossfblev.v;
-            cftl = cftl * cftl * cftl;
-
-            tapData[tap].modulator.step();
-            auto tt = baseTapSamples[tap] *
-                      (1 + modDepthScale * tapData[tap].moddepth.v * tapData[tap].modulator.u);
-
-            auto smpL = delayLine[0].read(tt);
-            auto smpR = delayLine[1].read(tt);
-
-            auto dL = smpL * tapPanMatrix[tap][0] + smpR * tapPanMatrix[tap][2];
-            auto dR = smpR * tapPanMatrix[tap][1] + smpL * tapPanMatrix[tap][3];
-
-            dL = dL * tl;
-            dR = dR * tl;
-
-            hp[tap].process_sample(dL, dR, dL, dR);
-            lp[tap].process_sample(dL, dR, dL, dR);
-
-            tapMx[tap][0] = std::max(tapMx[tap][0], std::abs(dL));
-            tapMx[tap][1] = std::max(tapMx[tap][1], std::abs(dR));
-
-            totalTapOut[0] += dL;
-            totalTapOut[1] += dR;
-
-            totalTapFB[0] += smpL * ftl + smpR * cftl;
-            totalTapFB[1] += smpR * ftl + smpL * cftl;
+            tm.live.tapVu[t][c] = tapOutVU[t].vu_peak[c];
         }
+    }
+    tm.publish();
 
-        auto dl = (*dryLev);
-        dl = dl * dl * dl;
-        for (auto c = 0U; c < chans; ++c)
-        {
-            out[c][i] = in[c][i] * dl + totalTapOut[c];
+    tail.update(writeMx < shared::silenceThreshold, true, frames, longestTap + settle);
+    return tail.asleep ? CLAP_PROCESS_SLEEP : CLAP_PROCESS_CONTINUE;
+}
 
-            delayLine[c].write(in[c][i] + totalTapFB[c]);
-            inMx[c] = std::max(inMx[c], std::abs(in[c][i]));
-            outMx[c] = std::max(outMx[c], std::abs(out[c][i]));
-        }
+void ConduitPolymetricDelay::flushDelayLines(uint32_t samples)
+{
+    samples = std::min(samples, dlSize);
+    for (auto c = 0; c < 2; ++c)
+        for (auto s = 0U; s < samples; ++s)
+            delayLine[c].write(0.f);
+    tail.quietSamples += samples;
+}
 
-        processLags();
+uint32_t ConduitPolymetricDelay::longestTapSamples() const
+{
+    float longest{0};
+    for (int i = 0; i < nTaps; ++i)
+    {
+        if (*(tapData[i].active) < 0.5)
+            continue;
+        auto depth = std::fabs(tapData[i].moddepth.v);
+        longest = std::max(longest, baseTapSamples[i] * (1 + modDepthScale * depth));
     }
+    // and the sinc interpolator reads a few samples either side
+    return (uint32_t)std::min<float>(longest, dlSize) + 32;
+}
 
-    for (int c = 0; c < 2; ++c)
+uint32_t ConduitPolymetricDelay::feedbackTailSamples(uint32_t longestTap, uint32_t settle) const
+{
+    // Every tap's feedback sums into both lines, so the loop gain is their total
+    float gain{0};
+    for (int i = 0; i < nTaps; ++i)
     {
-        uiComms.dataCopyForUI.inVu[c] = inVU.vu_peak[c];
-        uiComms.dataCopyForUI.outVu[c] = outVU.vu_peak[c];
-        for (int t = 0; t < nTaps; ++t)
-        {
-            uiComms.dataCopyForUI.tapVu[t][c] = tapOutVU[t].vu_peak[c];
-        }
+        if (*(tapData[i].active) < 0.5)
+            continue;
+        auto fb = tapData[i].fblev.v, cfb = tapData[i].crossfblev.v;
+        gain += std::fabs(fb * fb * fb) + std::fabs(cfb * cfb * cfb);
     }
+    if (gain >= 1.f)
+        return shared::infiniteTail;
 
-    return CLAP_PROCESS_CONTINUE;
+    auto repeats = gain > 0.f ? std::ceil(std::log(shared::silenceThreshold) / std::log(gain)) : 1;
+    auto res = (double)longestTap * (repeats + 1) + settle;
+    return (uint32_t)std::min<double>(res, shared::infiniteTail - 1);
 }
 
 void ConduitPolymetricDelay::handleInboundEvent(const clap_event_header_t *evt)
@@ -406,15 +461,7 @@ void ConduitPolymetricDelay::handleInboundEvent(const clap_event_header_t *evt)
             recalcTaps();
         }
 
-        uiComms.dataCopyForUI.tempo = tev->tempo;
-        uiComms.dataCopyForUI.bar_start = tev->bar_start;
-        uiComms.dataCopyForUI.bar_number = tev->bar_number;
-        uiComms.dataCopyForUI.song_pos_beats = tev->song_pos_beats;
-        uiComms.dataCopyForUI.tsig_num = tev->tsig_num;
-        uiComms.dataCopyForUI.tsig_denom = tev->tsig_denom;
-
-        uiComms.dataCopyForUI.isPlayingOrRecording =
-            (tev->flags & CLAP_TRANSPORT_IS_PLAYING) || (tev->flags & CLAP_TRANSPORT_IS_RECORDING);
+        uiComms.dataCopyForUI.telemetry.live.transport.update(tev);
     }
     break;
     }
@@ -41,6 +41,7 @@
 #include "sst/filters/BiquadFilter.h"
 
 #include "conduit-shared/clap-base-class.h"
+#include "conduit-shared/telemetry.h"
 
 namespace sst::conduit::polymetric_delay
 {
@@ -53,20 +54,19 @@ struct ConduitPolymetricDelayConfig
     static constexpr bool baseClassProvidesMonoModSupport{true};
     static constexpr bool usesSpecializedMessages{false};
     using PatchExtension = sst::conduit::shared::EmptyPatchExtension;
+    // What process reports, published once a block through DataCopyForUI::telemetry
+    struct Telemetry
+    {
+        sst::conduit::shared::TransportTelemetry transport;
+        float inVu[2]{}, outVu[2]{}, tapVu[4][2]{};
+    };
+
     struct DataCopyForUI
     {
         std::atomic<uint32_t> updateCount{0};
         std::atomic<bool> isProcessing{false};
 
-        std::atomic<bool> isPlayingOrRecording;
-        std::atomic<double> tempo;
-        std::atomic<clap_beattime> bar_start;
-        std::atomic<int32_t> bar_number;
-        std::atomic<clap_beattime> song_pos_beats;
-
-        std::atomic<uint16_t> tsig_num, tsig_denom;
-
-        std::atomic<float> inVu[2], outVu[2], tapVu[4][2];
+        sst::conduit::shared::Telemetry<Telemetry> telemetry;
     };
 
     static const clap_plugin_descriptor *getDescription();
@@ -166,7 +166,7 @@ struct ConduitPolymetricDelay
     typedef std::unordered_map<int, int> PatchPluginExtension;
 
     sst::basic_blocks::dsp::VUPeak inVU, outVU, tapOutVU[nTaps];
-    uint32_t slowProcess{blockSize};
+    uint32_t slowProcess{0}; // position in the VU / pan / filter recalc block
 
     // For now our strategy is to just have honkin big delay lines
     // but we want to make these adapt with max time going forward
@@ -175,6 +175,24 @@ struct ConduitPolymetricDelay
     static constexpr uint32_t dlSize{1 << 20};
     sst::basic_blocks::dsp::SSESincDelayLine<dlSize> delayLine[2]{st, st};
 
+    /*
+     * Once nothing audible has been written to the delay lines for as long as the
+     * longest tap reaches back, plus a moment for the tap filters to settle, the output
+     * can only be the dry input. The tail we tell the host is the feedback decay worked
+     * out from the loop gain, or infinite if the taps feed back at unity or more.
+     */
+    static constexpr double filterSettleSeconds{0.25};
+    uint32_t longestTapSamples() const;
+
+    /*
+     * Asleep the write head stands still, so behind it only tail.quietSamples are known
+     * silent and anything older is still in the lines. A tempo or tap time change can
+     * reach a tap past that while we sleep, so then we write that far of silence first.
+     */
+    void flushDelayLines(uint32_t samples);
+    uint32_t feedbackTailSamples(uint32_t longestTap, uint32_t settle) const;
+    bool implementsTail() const noexcept override { return true; }
+
   protected:
     std::unique_ptr<juce::Component> createEditor() override;
     std::atomic<bool> refreshUIValues{false};
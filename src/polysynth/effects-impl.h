@@ -42,7 +42,7 @@ struct SharedConfig
     using EffectStorage = ConduitPolysynth;
     using BiquadAdapter = SharedConfig;
     using ValueStorage = ConduitPolysynth;
-    static constexpr int blockSize{PolysynthVoice::blockSize};
+    static constexpr int blockSize{ConduitPolysynth::fxBlockSize};
 
     static float envelopeRateLinear(GlobalStorage *g, float f)
     {
@@ -50,7 +50,7 @@ struct SharedConfig
     }
     static bool isDeactivated(EffectStorage *, int) { return false; }
     static bool isExtended(EffectStorage *, int) { return false; }
-    static float rand01(GlobalStorage *g) { return g->urd(g->gen); }
+    static float rand01(GlobalStorage *g) { return g->rng.unipolar(); }
     static double sampleRate(GlobalStorage *g) { return g->sampleRate; }
     static double sampleRateInv(GlobalStorage *g) { return g->sampleRateInv; }
     static float noteToPitch(GlobalStorage *g, float note)
@@ -72,31 +72,25 @@ struct PhaserConfig : SharedConfig
          {0, -0.2, 1, 0, 1, 0.5, 0.5, 0, 4, 0.4, 1, 0},
          {-0.75, 0.797292, -0.3, -1, 0.994367, 1, 0.4, 0, 2, 0.7, 0, 0}}};
 
-    static int presetIndex(const BaseClass *bc)
-    {
-        auto s = bc->synth;
-        auto pn = s->paramToValue[ConduitPolysynth::pmModFXPreset];
-        return (int)std::round(*pn);
-    }
-
     static float temposyncRatio(GlobalStorage *g, EffectStorage *, int) { return 1.; }
 
     static float floatValueAt(const BaseClass *bc, const ValueStorage *, int idx)
     {
+        const auto &p = bc->synth->fxParams;
         if (idx == PhaserFX::ph_mix)
         {
-            return *(bc->synth->paramToValue[ConduitPolysynth::pmModFXMix]);
+            return p.modMix;
         }
 
         if (idx == PhaserFX::ph_mod_rate)
         {
-            return *(bc->synth->paramToValue[ConduitPolysynth::pmModFXRate]);
+            return p.modRate;
         }
-        return presets[presetIndex(bc)][idx];
+        return p.phaserPreset[idx];
     }
     static int intValueAt(const BaseClass *bc, const ValueStorage *, int idx)
     {
-        return (int)presets[presetIndex(bc)][idx];
+        return (int)bc->synth->fxParams.phaserPreset[idx];
     }
 };
 
@@ -109,27 +103,22 @@ struct FlangerConfig : SharedConfig
 
     static float temposyncRatio(GlobalStorage *g, EffectStorage *, int) { return 1.; }
 
-    static int presetIndex(const BaseClass *bc)
-    {
-        auto s = bc->synth;
-        auto pn = s->paramToValue[ConduitPolysynth::pmModFXPreset];
-        return (int)std::round(*pn);
-    }
     static float floatValueAt(const BaseClass *bc, const ValueStorage *, int idx)
     {
+        const auto &p = bc->synth->fxParams;
         if (idx == FlangerFX::fl_mix)
         {
-            return *(bc->synth->paramToValue[ConduitPolysynth::pmModFXMix]);
+            return p.modMix;
         }
         if (idx == FlangerFX::fl_rate)
         {
-            return *(bc->synth->paramToValue[ConduitPolysynth::pmModFXRate]);
+            return p.modRate;
         }
-        return presets[presetIndex(bc)][idx];
+        return p.flangerPreset[idx];
     }
     static int intValueAt(const BaseClass *bc, const ValueStorage *, int idx)
     {
-        return (int)presets[presetIndex(bc)][idx];
+        return (int)bc->synth->fxParams.flangerPreset[idx];
     }
 };
 
@@ -143,28 +132,22 @@ struct Reverb1Config : SharedConfig
 
     static float temposyncRatio(GlobalStorage *g, EffectStorage *, int) { return 1.; }
 
-    static int presetIndex(const BaseClass *bc)
-    {
-        auto s = bc->synth;
-        auto pn = s->paramToValue[ConduitPolysynth::pmRevFXPreset];
-        return (int)std::round(*pn);
-    }
-
     static float floatValueAt(const BaseClass *bc, const ValueStorage *, int idx)
     {
+        const auto &p = bc->synth->fxParams;
         if (idx == ReverbFX::rev1_mix)
         {
-            return *(bc->synth->paramToValue[ConduitPolysynth::pmRevFXMix]);
+            return p.revMix;
         }
         if (idx == ReverbFX::rev1_decaytime)
         {
-            return *(bc->synth->paramToValue[ConduitPolysynth::pmRevFXTime]);
+            return p.revTime;
         }
-        return presets[presetIndex(bc)][idx];
+        return p.reverbPreset[idx];
     }
     static int intValueAt(const BaseClass *bc, const ValueStorage *, int idx)
     {
-        return (int)presets[presetIndex(bc)][idx];
+        return (int)bc->synth->fxParams.reverbPreset[idx];
     }
 };
 } // namespace sst::conduit::polysynth
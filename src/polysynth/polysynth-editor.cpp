@@ -312,6 +312,9 @@ struct ModMatrixPanel : jcmp::NamedPanel
         void updateLabels();
     };
 
+    // The panel shows this many rows and scrolls through the rest
+    static constexpr int visibleRows{8};
+
     struct Content : juce::Component
     {
         void resized() override
@@ -328,6 +331,19 @@ struct ModMatrixPanel : jcmp::NamedPanel
         std::array<std::unique_ptr<ModMatrixRow>, polysynth::ModMatrixConfig::nModSlots> modRows;
     };
 
+    struct ContentViewport : juce::Viewport
+    {
+        ContentViewport() { setScrollBarsShown(true, false); }
+        void resized() override
+        {
+            juce::Viewport::resized();
+            if (auto c = getViewedComponent())
+                c->setSize(getMaximumVisibleWidth(), getMaximumVisibleHeight() *
+                                                         polysynth::ModMatrixConfig::nModSlots /
+                                                         visibleRows);
+        }
+    };
+
     std::map<std::string, std::map<std::string, int32_t>> sourceMenu;
     std::unordered_map<int32_t, std::string> sourceName;
 
@@ -361,6 +377,7 @@ struct StatusPanel : jcmp::NamedPanel
         {
             panel->mpeButton->widget->setBounds(0, 0, 200, 20);
             panel->voiceCountLabel->setBounds(0, 22, 200, 20);
+            panel->renderLoadLabel->setBounds(0, 44, 200, 20);
             panel->vuMeter->setBounds(getWidth() - 30, 0, 30, getHeight());
         }
 
@@ -375,16 +392,12 @@ struct StatusPanel : jcmp::NamedPanel
                 g.drawText(s, bx, juce::Justification::centredRight);
                 bx = bx.translated(0, bx.getHeight());
             };
+            auto tr = panel->uic.dataCopyForUI.telemetry.read().transport;
             d("Debug Info");
-            d(fmt::format("tempo={} play={}", panel->uic.dataCopyForUI.tempo.load(),
-                          panel->uic.dataCopyForUI.isPlayingOrRecording.load()));
-            d(fmt::format("tsig={}/{}", panel->uic.dataCopyForUI.tsig_num.load(),
-                          panel->uic.dataCopyForUI.tsig_denom.load()));
-            d(fmt::format("song pos={}", panel->uic.dataCopyForUI.song_pos_beats.load()));
-            d(fmt::format("bar start={} num={}", panel->uic.dataCopyForUI.bar_start.load(),
-                          panel->uic.dataCopyForUI.bar_number.load())
-
-            );
+            d(fmt::format("tempo={} play={}", tr.tempo, tr.isPlayingOrRecording));
+            d(fmt::format("tsig={}/{}", tr.tsig_num, tr.tsig_denom));
+            d(fmt::format("song pos={}", tr.song_pos_beats));
+            d(fmt::format("bar start={} num={}", tr.bar_start, tr.bar_number));
         }
     };
 
@@ -404,7 +417,7 @@ struct StatusPanel : jcmp::NamedPanel
     bool mpeActive{false};
 
     std::unique_ptr<jcmp::VUMeter> vuMeter;
-    std::unique_ptr<jcmp::Label> voiceCountLabel;
+    std::unique_ptr<jcmp::Label> voiceCountLabel, renderLoadLabel;
 };
 
 struct ModFXPanel : jcmp::NamedPanel
@@ -800,7 +813,9 @@ ModMatrixPanel::ModMatrixPanel(sst::conduit::polysynth::editor::uicomm_t &p,
         content->addAndMakeVisible(*(content->modRows[i]));
     }
 
-    setContentAreaComponent(std::move(content));
+    auto viewport = std::make_unique<ContentViewport>();
+    viewport->setViewedComponent(content.release(), true);
+    setContentAreaComponent(std::move(viewport));
 }
 
 ModMatrixPanel::ModMatrixRow::ModMatrixRow(
@@ -1030,6 +1045,10 @@ StatusPanel::StatusPanel(sst::conduit::polysynth::editor::uicomm_t &p,
     voiceCountLabel->setText("Voices: 0");
     content->addAndMakeVisible(*voiceCountLabel);
 
+    renderLoadLabel = std::make_unique<jcmp::Label>();
+    renderLoadLabel->setText("Load: 0%");
+    content->addAndMakeVisible(*renderLoadLabel);
+
     setContentAreaComponent(std::move(content));
 
     ed.comms->addIdleHandler("status", [this]() { updateStatus(); });
@@ -1039,8 +1058,20 @@ StatusPanel::~StatusPanel() { ed.comms->removeIdleHandler("status"); }
 
 void StatusPanel::updateStatus()
 {
-    vuMeter->setLevels(uic.dataCopyForUI.mainVU[0], uic.dataCopyForUI.mainVU[1]);
-    voiceCountLabel->setText("Voices : " + std::to_string(uic.dataCopyForUI.polyphony));
+    auto tm = uic.dataCopyForUI.telemetry.read();
+    vuMeter->setLevels(tm.mainVU[0], tm.mainVU[1]);
+    auto voices = "Voices : " + std::to_string(tm.polyphony);
+    if (auto stolen = tm.voicesStolen)
+        voices += " (" + std::to_string(stolen) + " stolen)";
+    if (auto silenced = tm.voicesSilenced)
+        voices += " (" + std::to_string(silenced) + " silent)";
+    voiceCountLabel->setText(voices);
+
+    auto load = "Load : " + std::to_string((int)std::round(tm.renderLoad * 100));
+    load += "%";
+    if (auto cap = tm.unisonCap)
+        load += " (unison " + std::to_string(cap) + ")";
+    renderLoadLabel->setText(load);
     repaint();
 }
 
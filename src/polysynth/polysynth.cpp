@@ -23,6 +23,9 @@
 #include <iostream>
 #include <cmath>
 #include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <new>
 
 #include <iomanip>
 #include <locale>
@@ -59,8 +62,7 @@ const clap_plugin_descriptor *ConduitPolysynthConfig::getDescription()
 
 ConduitPolysynth::ConduitPolysynth(const clap_host *host)
     : sst::conduit::shared::ClapBaseClass<ConduitPolysynth, ConduitPolysynthConfig>(host),
-      gen((size_t)this), urd(0.f, 1.f), hr_dn(6, true), voiceManager(*this),
-      voices{sst::cpputils::make_array<PolysynthVoice, max_voices>(*this)}
+      voiceManager(*this)
 {
     auto autoFlag = CLAP_PARAM_IS_AUTOMATABLE;
     auto monoModFlag = autoFlag | CLAP_PARAM_IS_MODULATABLE;
@@ -550,20 +552,99 @@ ConduitPolysynth::ConduitPolysynth(const clap_host *host)
                                     .withFlags(monoModFlag)
                                     .withDefault(1.0));
 
+    paramDescriptions.push_back(ParamDesc()
+                                    .asInt()
+                                    .withID(pmPolyphony)
+                                    .withName("Polyphony")
+                                    .withGroupName("Global")
+                                    .withRange(1, max_voices)
+                                    .withDefault(64)
+                                    .withFlags(CLAP_PARAM_IS_STEPPED)
+                                    .withLinearScaleFormatting("voices"));
+
+    paramDescriptions.push_back(
+        sst::conduit::shared::oversamplingParamDesc(pmOversampling, "Global"));
+
+    paramDescriptions.push_back(ParamDesc()
+                                    .asInt()
+                                    .withID(pmStealPolicy)
+                                    .withName("Voice Stealing")
+                                    .withGroupName("Global")
+                                    .withRange(stealOldest, stealReleasedFirst)
+                                    .withDefault(stealReleasedFirst)
+                                    .withFlags(CLAP_PARAM_IS_AUTOMATABLE | CLAP_PARAM_IS_STEPPED)
+                                    .withUnorderedMapFormatting({
+                                        {stealOldest, "Oldest"},
+                                        {stealQuietest, "Quietest"},
+                                        {stealSameKey, "Same Key"},
+                                        {stealReleasedFirst, "Released"},
+                                    }));
+
+    paramDescriptions.push_back(ParamDesc()
+                                    .asPercent()
+                                    .withID(pmRenderLoadLimit)
+                                    .withName("Render Load Limit")
+                                    .withGroupName("Global")
+                                    .withRange(0.1, 1.0)
+                                    .withDefault(0.8)
+                                    .withFlags(CLAP_PARAM_IS_AUTOMATABLE));
+
+    paramDescriptions.push_back(ParamDesc()
+                                    .asFloat()
+                                    .withID(pmReleaseSilenceFloor)
+                                    .withName("Release Silence Floor")
+                                    .withGroupName("Global")
+                                    .withRange(-144, -48)
+                                    .withDefault(-96)
+                                    .withLinearScaleFormatting("dB")
+                                    .withFlags(CLAP_PARAM_IS_AUTOMATABLE));
+
+    paramDescriptions.push_back(ParamDesc()
+                                    .asBool()
+                                    .withID(pmFXPipeline)
+                                    .withName("Pipeline Effects")
+                                    .withGroupName("Global")
+                                    .withDefault(false)
+                                    .withFlags(CLAP_PARAM_IS_STEPPED));
+
+    paramDescriptions.push_back(ParamDesc()
+                                    .asInt()
+                                    .withID(pmRenderThreads)
+                                    .withName("Render Threads")
+                                    .withGroupName("Global")
+                                    .withRange(1, maxRenderTasks)
+                                    .withDefault(1)
+                                    .withFlags(CLAP_PARAM_IS_STEPPED)
+                                    .withLinearScaleFormatting("threads"));
+
+    paramDescriptions.push_back(ParamDesc()
+                                    .asInt()
+                                    .withID(pmRandomSeed)
+                                    .withName("Random Seed")
+                                    .withGroupName("Global")
+                                    .withRange(0, maxRandomSeedParam)
+                                    .withDefault(0)
+                                    .withFlags(CLAP_PARAM_IS_STEPPED)
+                                    .withLinearScaleFormatting(""));
+
     configureParams();
 
+    for (auto i = 0U; i < paramDescriptions.size(); ++i)
+    {
+        cbassert(paramDescriptions[i].id == patchOrder[i], "patchOrder does not match the params");
+    }
+
     terminatedVoices.reserve(max_voices * 4);
 
     clapJuceShim = std::make_unique<sst::clap_juce_shim::ClapJuceShim>(this);
     clapJuceShim->setResizable(true);
 
-    mtsClient = MTS_RegisterClient();
-
-    if (mtsClient)
+    if (tuning.client())
     {
-        if (MTS_HasMaster(mtsClient))
+        if (tuning.hasMaster())
         {
-            CNDOUT << "MTS: Client registered with " << MTS_GetScaleName(mtsClient) << std::endl;
+            CNDOUT << "MTS: Client registered with " << MTS_GetScaleName(tuning.client())
+                   << std::endl;
         }
         else
         {
@@ -571,6 +652,7 @@ ConduitPolysynth::ConduitPolysynth(const clap_host *host)
         }
     }
 
+    snapshotFXParams();
     phaserFX = std::make_unique<PhaserFX>(this, this, this);
     phaserFX->initialize();
 
@@ -580,19 +662,11 @@ ConduitPolysynth::ConduitPolysynth(const clap_host *host)
     reverbFX = std::make_unique<ReverbFX>(this, this, this);
     reverbFX->initialize();
 
-    for (auto &v : voices)
-    {
-        v.attachTo(*this);
-    }
-
-    patch.extension.initialize();
     uiComms.dataCopyForUI.populateMatrixView(patch.extension.modMatrixConfig);
+    compileModProgram();
 }
 ConduitPolysynth::~ConduitPolysynth()
 {
-    if (mtsClient)
-        MTS_DeregisterClient(mtsClient);
-
     // I *think* this is a bitwig bug that they won't call guiDestroy if destroying a plugin
     // with an open window but
     if (clapJuceShim)
@@ -603,15 +677,154 @@ bool ConduitPolysynth::activate(double sampleRate, uint32_t minFrameCount,
                                 uint32_t maxFrameCount) noexcept
 {
     setSampleRate(sampleRate);
-    for (auto &v : voices)
-        v.setSampleRate(sampleRate * 2); // run voices oversampled
+
+    auto newPolyphony = std::clamp((int)patch.params[patchIndexOf(pmPolyphony)], 1, max_voices);
+    if (newPolyphony != polyphony)
+    {
+        // Anything still sounding from the last activation goes with the old pool
+        for (auto i = 0; i < nActiveVoices; ++i)
+        {
+            if (!activeVoices[i]->stolen)
+                voiceEndCallback(activeVoices[i]);
+        }
+        nActiveVoices = 0;
+        liveTelemetry().polyphony = 0;
+
+        combArena = nullptr;
+        combArenaStorage.reset();
+        polyphony = newPolyphony;
+        voices.allocate(*this, polyphony + stealReserveFor(polyphony));
+        resetVoiceLists();
+
+        // Hand out voices low index first, as the old linear search for a free slot did
+        nFreeVoices = 0;
+        for (auto i = voices.size() - 1; i >= 0; --i)
+        {
+            freeVoices[nFreeVoices++] = &voices[i];
+        }
+    }
+    restartRequested = false;
+    combArenaRequested = false;
+
+    renderLoadMeter.reset();
+    unisonCap = PolysynthVoice::max_uni;
+    secondsSinceUnisonCapChange = 0;
+    secondsSinceShed = 0;
+    if (patchUsesComb())
+        allocateCombArena();
+
+    oversampler.reset();
+    updateOversampling(true);
+    snapshotFXParams();
     phaserFX->onSampleRateChanged();
     flangerFX->onSampleRateChanged();
     reverbFX->onSampleRateChanged();
     mainVU.setSampleRate(sampleRate);
+
+    // Latency may only change while we activate, so this is where the bus mode is taken up
+    fxPipelined = patch.params[patchIndexOf(pmFXPipeline)] > 0.5;
+    auto newLatency =
+        fxPipelined ? (uint32_t)(2 * fxBlockSize - PolysynthVoice::blockSize) : 0U;
+    if (newLatency != fxLatency)
+    {
+        fxLatency = newLatency;
+        if (_host.canUseLatency())
+            _host.latencyChanged();
+    }
+    fxWorker.reset();
+    if (fxPipelined)
+        fxWorker = std::make_unique<sst::conduit::shared::PipelineWorker>();
+    resetEffectsBus();
+    uiComms.dataCopyForUI.telemetry.publish();
+
+    randomSeedParam =
+        std::clamp((int)patch.params[patchIndexOf(pmRandomSeed)], 0, maxRandomSeedParam);
+    setRandomSeed(randomSeedParam ? (uint64_t)randomSeedParam : instanceSeed);
+
+    renderThreads =
+        std::clamp((int)patch.params[patchIndexOf(pmRenderThreads)], 1, maxRenderTasks);
+    renderPool.reset();
+    if (renderThreads > 1 && !_host.canUseThreadPool())
+    {
+        renderPool = std::make_unique<sst::conduit::shared::TaskPool>(renderThreads - 1);
+    }
+    if (renderThreads > 1)
+    {
+        CNDOUT << "Parallel voice render " << CNDVAR(renderThreads)
+               << (renderPool ? "on our own pool" : "on the host pool") << std::endl;
+    }
+
     return true;
 }
 
+void ConduitPolysynth::deactivate() noexcept
+{
+    fxWorker.reset();
+    renderPool.reset();
+}
+
+void ConduitPolysynth::VoicePool::allocate(ConduitPolysynth &synth, int n)
+{
+    release();
+    auto mem =
+        ::operator new(n * sizeof(PolysynthVoice), std::align_val_t{alignof(PolysynthVoice)});
+    data = static_cast<PolysynthVoice *>(mem);
+    for (count = 0; count < n; ++count)
+    {
+        auto v = new (data + count) PolysynthVoice(synth);
+        v->poolIndex = count;
+        v->noiseRng.reseed(synth.randomSeed + 1 + count);
+        v->attachTo(synth);
+    }
+}
+
+uint64_t ConduitPolysynth::nextInstanceSeed()
+{
+    // Voices take the seeds just after ours, so space instances well apart
+    static std::atomic<uint64_t> instances{0};
+    return sst::conduit::shared::BlockRNG::defaultSeed + (instances++ << 32);
+}
+
+void ConduitPolysynth::setRandomSeed(uint64_t seed)
+{
+    randomSeed = seed;
+    rng.reseed(seed);
+    for (auto &v : voices)
+        v.noiseRng.reseed(seed + 1 + v.poolIndex);
+}
+
+void ConduitPolysynth::VoicePool::release()
+{
+    if (!data)
+        return;
+    for (auto &v : *this)
+        v.~PolysynthVoice();
+    ::operator delete(data, std::align_val_t{alignof(PolysynthVoice)});
+    data = nullptr;
+    count = 0;
+}
+
+bool ConduitPolysynth::patchUsesComb() const
+{
+    return patch.params[patchIndexOf(pmLPFActive)] > 0.5 &&
+           (int)std::round(patch.params[patchIndexOf(pmLPFFilterMode)]) == PolysynthVoice::Comb;
+}
+
+void ConduitPolysynth::allocateCombArena()
+{
+    if (combArenaStorage)
+        return;
+    combArenaStorage = std::make_unique<float[]>(voices.size() * 2 * combLineSize);
+    combArena.store(combArenaStorage.get(), std::memory_order_release);
+}
+
+void ConduitPolysynth::onMainThread() noexcept
+{
+    if (combArenaRequested)
+        allocateCombArena();
+    ClapBaseClass::onMainThread();
+}
+
 /*
  * Stereo out, Midi in, in a pretty obvious way.
  * The only trick is the idi in also has NOTE_DIALECT_CLAP which provides us
@@ -666,10 +879,15 @@ bool ConduitPolysynth::notePortsInfo(uint32_t index, bool isInput,
  */
 clap_process_status ConduitPolysynth::process(const clap_process *process) noexcept
 {
+    shared::rtcheck::AudioThreadScope rtScope;
+    PatchSwapScope patchSwap{*this, process};
+
     // If I have no outputs, do nothing
     if (process->audio_outputs_count <= 0)
         return CLAP_PROCESS_SLEEP;
 
+    renderLoadMeter.begin();
+
     /*
      * Stage 1:
      *
@@ -680,13 +898,41 @@ clap_process_status ConduitPolysynth::process(const clap_process *process) noexc
     if (ct)
         pushParamsToVoices();
 
+    updateOversampling(false);
+    if (modProgramDirty.exchange(false))
+        compileModProgram();
+    releaseSilenceFloor = std::pow(10.f, patch.params[patchIndexOf(pmReleaseSilenceFloor)] / 20);
+
+    /*
+     * Voice storage, our latency, the render threads and the seed are fixed at activate, so
+     * changing any of them needs a restart, and a first comb needs the main thread
+     */
+    auto wantPipeline = patch.params[patchIndexOf(pmFXPipeline)] > 0.5;
+    auto wantThreads =
+        std::clamp((int)patch.params[patchIndexOf(pmRenderThreads)], 1, maxRenderTasks);
+    auto wantSeed =
+        std::clamp((int)patch.params[patchIndexOf(pmRandomSeed)], 0, maxRandomSeedParam);
+    if (!restartRequested && ((int)patch.params[patchIndexOf(pmPolyphony)] != polyphony ||
+                              wantPipeline != fxPipelined || wantThreads != renderThreads ||
+                              wantSeed != randomSeedParam))
+    {
+        restartRequested = true;
+        _host.requestRestart();
+    }
+    if (!combArenaRequested && !combArena.load(std::memory_order_relaxed) && patchUsesComb())
+    {
+        combArenaRequested = true;
+        _host.requestCallback();
+    }
+
     /*
      * Stage 2: Create the AUDIO output and process events
      *
      * CLAP has a single inbound event loop where every event is time stamped with
      * a sample id. This means the process loop can easily interleave note and parameter
-     * and other events with audio generation. Here we do everything completely sample accurately
-     * by maintaining a pointer to the 'nextEvent' which we check at every sample.
+     * and other events with audio generation. processEventSliced splits the buffer into
+     * spans at every event and at every boundary of our internal block, so we stay
+     * sample accurate but copy out contiguous runs rather than checking every sample.
      */
     float **out = process->audio_outputs[0].data32;
     auto chans = process->audio_outputs->channel_count;
@@ -695,79 +941,68 @@ clap_process_status ConduitPolysynth::process(const clap_process *process) noexc
         return CLAP_PROCESS_SLEEP;
     }
 
-    auto ev = process->in_events;
-    auto sz = ev->size(ev);
+    liveTelemetry().transport.update(process->transport);
 
-    // This pointer is the sentinel to our next event which we advance once an event is processed
-    const clap_event_header_t *nextEvent{nullptr};
-    uint32_t nextEventIndex{0};
-    if (sz != 0)
+    auto frames = process->frames_count;
+    reportTail(effectsTailSamples());
+    if (tail.asleep && nActiveVoices == 0 && process->in_events->size(process->in_events) == 0)
     {
-        nextEvent = ev->get(ev, nextEventIndex);
-    }
-
-    if (process->transport)
-    {
-        auto tev = process->transport;
-
-        uiComms.dataCopyForUI.tempo = tev->tempo;
-        uiComms.dataCopyForUI.bar_start = tev->bar_start;
-        uiComms.dataCopyForUI.bar_number = tev->bar_number;
-        uiComms.dataCopyForUI.song_pos_beats = tev->song_pos_beats;
-        uiComms.dataCopyForUI.tsig_num = tev->tsig_num;
-        uiComms.dataCopyForUI.tsig_denom = tev->tsig_denom;
-
-        uiComms.dataCopyForUI.isPlayingOrRecording =
-            (tev->flags & CLAP_TRANSPORT_IS_PLAYING) || (tev->flags & CLAP_TRANSPORT_IS_RECORDING);
+        memset(out[0], 0, frames * sizeof(float));
+        memset(out[1], 0, frames * sizeof(float));
+        liveTelemetry().mainVU[0] = 0.f;
+        liveTelemetry().mainVU[1] = 0.f;
+        uiComms.dataCopyForUI.telemetry.publish();
+        return CLAP_PROCESS_SLEEP;
     }
 
-    bool modActive = *paramToValue[pmModFXActive] > 0.5;
-    bool revActive = *paramToValue[pmRevFXActive] > 0.5;
-    bool usePhaser = *paramToValue[pmModFXType] < 0.5;
-
-    for (auto i = 0U; i < process->frames_count; ++i)
-    {
-        // Do I have an event to process. Note that multiple events
-        // can occur on the same sample, hence 'while' not 'if'
-        while (nextEvent && nextEvent->time == i)
-        {
-            // handleInboundEvent is a separate function which adjusts the state based
-            // on event type. We segregate it for clarity but you really should read it!
-            handleInboundEvent(nextEvent);
-            nextEventIndex++;
-            if (nextEventIndex >= sz)
-                nextEvent = nullptr;
-            else
-                nextEvent = ev->get(ev, nextEventIndex);
-        }
+    // Asleep nothing is sounding to retune, so the MTS lookups wait until we wake
+    tuning.refresh();
 
-        if (blockPos == 0)
-        {
-            renderVoices();
-            if (modActive)
+    processEventSliced<PolysynthVoice::blockSize>(
+        process, blockPos,
+        // handleInboundEvent is a separate function which adjusts the state based
+        // on event type. We segregate it for clarity but you really should read it!
+        [this](auto *evt) { handleInboundEvent(evt); },
+        [&](uint32_t start, uint32_t n, uint32_t pos) {
+            if (pos == 0)
             {
-                if (usePhaser)
+                auto &fill = busBlocks[busFillBlock];
+                if (fxPipelined)
                 {
-                    phaserFX->processBlock(output[0], output[1]);
+                    renderVoices(fill[0] + busPos, fill[1] + busPos);
+                    busPos += PolysynthVoice::blockSize;
+                    if (busPos == fxBlockSize)
+                    {
+                        advanceEffectsBus();
+                        busPos = 0;
+                    }
+                    busReadPos = busPos;
                 }
                 else
                 {
-                    flangerFX->processBlock(output[0], output[1]);
+                    if (busPos == 0)
+                    {
+                        for (auto b = 0; b < fxBlockSize; b += PolysynthVoice::blockSize)
+                            renderVoices(fill[0] + b, fill[1] + b);
+                        advanceEffectsBus();
+                    }
+                    busReadPos = busPos;
+                    busPos = (busPos + PolysynthVoice::blockSize) % fxBlockSize;
                 }
+
+                auto &read = busBlocks[busReadBlock];
+                mainVU.process<PolysynthVoice::blockSize>(read[0] + busReadPos,
+                                                          read[1] + busReadPos);
+                liveTelemetry().mainVU[0] = mainVU.vu_peak[0];
+                liveTelemetry().mainVU[1] = mainVU.vu_peak[1];
             }
-            if (revActive)
-            {
-                reverbFX->processBlock(output[0], output[1]);
-            }
-            mainVU.process<PolysynthVoice::blockSize>(output[0], output[1]);
-            uiComms.dataCopyForUI.mainVU[0] = mainVU.vu_peak[0];
-            uiComms.dataCopyForUI.mainVU[1] = mainVU.vu_peak[1];
-        }
-        out[0][i] = output[0][blockPos];
-        out[1][i] = output[1][blockPos];
+            auto &read = busBlocks[busReadBlock];
+            memcpy(out[0] + start, read[0] + busReadPos + pos, n * sizeof(float));
+            memcpy(out[1] + start, read[1] + busReadPos + pos, n * sizeof(float));
+        });
 
-        blockPos = (blockPos + 1) & (PolysynthVoice::blockSize - 1);
-    }
+    auto voicesSounded = nActiveVoices > 0;
+    adaptToRenderLoad(frames);
 
     /*
      * Stage 3 is to inform the host of our terminated voices.
@@ -778,15 +1013,26 @@ clap_process_status ConduitPolysynth::process(const clap_process *process) noexc
      *
      * Note that there are two ways to enter the terminatedVoices array. The first
      * is here through natural state transition to NEWLY_OFF and the second is in
-     * handleNoteOn when we steal a voice.
+     * stealVoice. A stolen voice was ended then, so when its fade finishes here we
+     * just hand it back to the pool.
      */
-    for (auto &v : voices)
+    for (auto i = nActiveVoices - 1; i >= 0; --i)
     {
-        if (v.active && !v.isPlaying())
+        auto &v = *activeVoices[i];
+        if (!v.isPlaying())
         {
-            terminatedVoices.emplace_back(v.portid, v.channel, v.key, v.note_id);
             v.active = false;
+            retireVoice(v);
+            if (v.stolen)
+            {
+                fadingVoices.remove(v);
+                continue;
+            }
+            terminatedVoices.emplace_back(v.portid, v.channel, v.key, v.note_id);
+            voiceStopped(v);
             voiceEndCallback(&v);
+            if (v.silenced)
+                liveTelemetry().voicesSilenced++;
         }
     }
 
@@ -810,32 +1056,275 @@ clap_process_status ConduitPolysynth::process(const clap_process *process) noexc
         ov->try_push(ov, &(evt.header));
 
         uiComms.dataCopyForUI.updateCount++;
-        uiComms.dataCopyForUI.polyphony--;
+        liveTelemetry().polyphony--;
     }
     terminatedVoices.clear();
 
-    // We should have gotten all the events
-    assert(!nextEvent);
+    auto quietOut = !voicesSounded &&
+                    std::max(shared::bufferPeak(out[0], frames),
+                             shared::bufferPeak(out[1], frames)) < shared::silenceThreshold;
+    tail.update(!voicesSounded, quietOut, frames, effectsTailSamples());
+    uiComms.dataCopyForUI.telemetry.publish();
+    return tail.asleep ? CLAP_PROCESS_SLEEP : CLAP_PROCESS_CONTINUE;
+}
+
+uint32_t ConduitPolysynth::effectsTailSamples() const
+{
+    double seconds{0};
+    if (patch.params[patchIndexOf(pmModFXActive)] > 0.5)
+        seconds += modFXTailSeconds;
+    if (patch.params[patchIndexOf(pmRevFXActive)] > 0.5)
+    {
+        // decay time is roughly the time to fall 60dB; we want twice that to reach silence
+        auto preset = std::clamp((int)std::round(patch.params[patchIndexOf(pmRevFXPreset)]), 0,
+                                 (int)Reverb1Config::presets.size() - 1);
+        auto predelay = std::pow(2.0, Reverb1Config::presets[preset][ReverbFX::rev1_predelay]);
+        auto decay = std::pow(2.0, patch.params[patchIndexOf(pmRevFXTime)]);
+        seconds += predelay + 2 * decay;
+    }
+    return (uint32_t)(seconds * sampleRate) + oversampler.tailSamples() +
+           PolysynthVoice::blockSizeOS + fxLatency;
+}
+
+void ConduitPolysynth::resetEffectsBus()
+{
+    if (fxWorker)
+        fxWorker->join();
+    memset(busBlocks, 0, sizeof(busBlocks));
+    busPos = 0;
+    busReadPos = 0;
+    busFillBlock = 0;
+    busRunBlock = 1;
+    busReadBlock = 2;
+}
+
+void ConduitPolysynth::advanceEffectsBus()
+{
+    // The worker reads the fx switches, so they only change once it is done with a block
+    if (fxWorker)
+        fxWorker->join();
+    fxModActive = patch.params[patchIndexOf(pmModFXActive)] > 0.5;
+    fxRevActive = patch.params[patchIndexOf(pmRevFXActive)] > 0.5;
+    fxUsePhaser = patch.params[patchIndexOf(pmModFXType)] < 0.5;
+    snapshotFXParams();
+
+    if (!fxWorker)
+    {
+        runEffectsBus(busBlocks[busFillBlock]);
+        std::swap(busFillBlock, busReadBlock);
+        return;
+    }
+
+    // The block the worker had is done; read it next, and give it the one we just filled
+    auto done = busRunBlock;
+    busRunBlock = busFillBlock;
+    busFillBlock = busReadBlock;
+    busReadBlock = done;
+    fxWorker->launch(
+        [](void *ctx) {
+            auto s = static_cast<ConduitPolysynth *>(ctx);
+            s->runEffectsBus(s->busBlocks[s->busRunBlock]);
+        },
+        this);
+}
+
+void ConduitPolysynth::snapshotFXParams()
+{
+    auto &p = fxParams;
+    p.modMix = patch.params[patchIndexOf(pmModFXMix)];
+    p.modRate = patch.params[patchIndexOf(pmModFXRate)];
+    p.revMix = patch.params[patchIndexOf(pmRevFXMix)];
+    p.revTime = patch.params[patchIndexOf(pmRevFXTime)];
+
+    auto modPreset = patch.params[patchIndexOf(pmModFXPreset)];
+    if (modPreset != p.modPreset)
+    {
+        p.modPreset = modPreset;
+        auto ph = std::clamp((int)std::round(modPreset), 0, (int)PhaserConfig::presets.size() - 1);
+        auto fl = std::clamp((int)std::round(modPreset), 0, (int)FlangerConfig::presets.size() - 1);
+        p.phaserPreset = PhaserConfig::presets[ph].data();
+        p.flangerPreset = FlangerConfig::presets[fl].data();
+    }
 
-    return CLAP_PROCESS_CONTINUE;
+    auto revPreset = patch.params[patchIndexOf(pmRevFXPreset)];
+    if (revPreset != p.revPreset)
+    {
+        p.revPreset = revPreset;
+        auto rv = std::clamp((int)std::round(revPreset), 0, (int)Reverb1Config::presets.size() - 1);
+        p.reverbPreset = Reverb1Config::presets[rv].data();
+    }
+}
+
+void ConduitPolysynth::runEffectsBus(float (&block)[2][fxBlockSize])
+{
+    if (fxModActive)
+    {
+        if (fxUsePhaser)
+            phaserFX->processBlock(block[0], block[1]);
+        else
+            flangerFX->processBlock(block[0], block[1]);
+    }
+    if (fxRevActive)
+        reverbFX->processBlock(block[0], block[1]);
 }
 
-void ConduitPolysynth::renderVoices()
+void ConduitPolysynth::updateOversampling(bool force)
 {
-    memset(outputOS, 0, sizeof(outputOS));
+    auto mode = (int)std::round(patch.params[patchIndexOf(pmOversampling)]);
+    auto wsActive = patch.params[patchIndexOf(pmWSActive)] > 0.5;
+    auto osLog2 = shared::oversamplingFactorLog2(mode, sampleRate, wsActive);
+    if (!oversampler.setFactorLog2(osLog2) && !force)
+        return;
+
+    // Playing voices carry on at the new rate; their coefficients are redone next block
     for (auto &v : voices)
+        v.setSampleRate(sampleRate * oversampler.factor());
+    renderedPos = 0;
+    renderedCount = 0;
+}
+
+void ConduitPolysynth::renderVoices(float *intoL, float *intoR)
+{
+    /*
+     * That is one voice block per output block at 2x, several at 4x and 8x, and one for
+     * every other output block at 1x. So at 1x an event in the second half of a voice
+     * block reaches the voices a block later than it otherwise would.
+     */
+    for (int filled = 0; filled < PolysynthVoice::blockSize;)
+    {
+        if (renderedPos == renderedCount)
+        {
+            renderVoiceBlock();
+            oversampler.downsample(outputOS[0], outputOS[1], rendered[0], rendered[1],
+                                   PolysynthVoice::blockSizeOS);
+            renderedPos = 0;
+            renderedCount = PolysynthVoice::blockSizeOS >> oversampler.factorLog2();
+        }
+        auto n = std::min(PolysynthVoice::blockSize - filled, renderedCount - renderedPos);
+        memcpy(intoL + filled, rendered[0] + renderedPos, n * sizeof(float));
+        memcpy(intoR + filled, rendered[1] + renderedPos, n * sizeof(float));
+        filled += n;
+        renderedPos += n;
+    }
+}
+
+void ConduitPolysynth::renderVoiceBlock()
+{
+    namespace mech = sst::basic_blocks::mechanics;
+
+    // envelope levels move with every voice block, so the quietest heap is stale now
+    quietHeapValid = false;
+
+    renderListSize = 0;
+    for (auto i = 0; i < nActiveVoices; ++i)
     {
-        if (v.isPlaying())
+        if (activeVoices[i]->isPlaying())
+            renderList[renderListSize++] = activeVoices[i];
+    }
+
+    nRenderTasks = 1;
+    if (renderThreads > 1)
+    {
+        nRenderTasks = std::clamp(renderListSize / minVoicesPerRenderTask, 1,
+                                  std::min(renderThreads, maxRenderTasks));
+    }
+
+    if (nRenderTasks == 1)
+    {
+        renderVoiceRange(renderList.data(), renderListSize, outputOS);
+    }
+    else
+    {
+        if (!(_host.canUseThreadPool() && _host.threadPoolRequestExec(nRenderTasks)))
+        {
+            if (renderPool)
+            {
+                renderPool->run(nRenderTasks, [this](uint32_t t) { renderVoiceTask(t); });
+            }
+            else
+            {
+                for (auto t = 0; t < nRenderTasks; ++t)
+                    renderVoiceTask(t);
+            }
+        }
+
+        memset(outputOS, 0, sizeof(outputOS));
+        for (auto t = 0; t < nRenderTasks; ++t)
         {
-            v.processBlock();
-            sst::basic_blocks::mechanics::accumulate_from_to<PolysynthVoice::blockSizeOS>(
-                v.outputOS[0], outputOS[0]);
-            sst::basic_blocks::mechanics::accumulate_from_to<PolysynthVoice::blockSizeOS>(
-                v.outputOS[1], outputOS[1]);
+            mech::accumulate_from_to<PolysynthVoice::blockSizeOS>(taskOutputOS[t][0], outputOS[0]);
+            mech::accumulate_from_to<PolysynthVoice::blockSizeOS>(taskOutputOS[t][1], outputOS[1]);
         }
     }
+}
 
-    hr_dn.process_block_D2(outputOS[0], outputOS[1], blockSize, output[0], output[1]);
+void ConduitPolysynth::renderVoiceTask(uint32_t task)
+{
+    auto from = task * renderListSize / nRenderTasks;
+    auto to = (task + 1) * renderListSize / nRenderTasks;
+    renderVoiceRange(renderList.data() + from, to - from, taskOutputOS[task]);
+}
+
+void ConduitPolysynth::renderVoiceRange(PolysynthVoice **vs, int n,
+                                        float (&into)[2][PolysynthVoice::blockSizeOS])
+{
+    namespace mech = sst::basic_blocks::mechanics;
+    memset(into, 0, sizeof(into));
+
+    auto finishVoice = [&into](PolysynthVoice &v) {
+        v.processBlockPostFilter();
+        mech::accumulate_from_to<PolysynthVoice::blockSizeOS>(v.outputOS[0], into[0]);
+        mech::accumulate_from_to<PolysynthVoice::blockSizeOS>(v.outputOS[1], into[1]);
+    };
+
+    /*
+     * A voice alone only fills two of the four lanes of the filter stage, so we hold
+     * voices which need a filter until another voice with a compatible filter setup
+     * arrives and then run the pair together. Anything unpaired at the end runs alone.
+     */
+    for (int vi = 0; vi < n; ++vi)
+        vs[vi]->processModulators();
+    modProgram.evaluate(vs, n);
+
+    std::array<PolysynthVoice *, max_pool> awaitingFilterPartner;
+    int nAwaiting{0};
+    for (int vi = 0; vi < n; ++vi)
+    {
+        auto &v = *vs[vi];
+
+        v.processBlockPreFilter();
+        if (!v.anyFilterStepActive || !pairVoiceFilterLanes)
+        {
+            v.processBlockFilters();
+            finishVoice(v);
+            continue;
+        }
+
+        bool paired{false};
+        for (int i = 0; i < nAwaiting; ++i)
+        {
+            auto &partner = *awaitingFilterPartner[i];
+            if (partner.canShareFilterLanesWith(v))
+            {
+                PolysynthVoice::processBlockFiltersPaired(partner, v);
+                finishVoice(partner);
+                finishVoice(v);
+                awaitingFilterPartner[i] = awaitingFilterPartner[nAwaiting - 1];
+                nAwaiting--;
+                paired = true;
+                break;
+            }
+        }
+        if (!paired)
+        {
+            awaitingFilterPartner[nAwaiting++] = &v;
+        }
+    }
+
+    for (int i = 0; i < nAwaiting; ++i)
+    {
+        awaitingFilterPartner[i]->processBlockFilters();
+        finishVoice(*awaitingFilterPartner[i]);
+    }
 }
 
 /*
@@ -866,18 +1355,20 @@ void ConduitPolysynth::handleInboundEvent(const clap_event_header_t *evt)
          * that) streams to do with as you wish. The CLAP_MIDI_EVENT here does the obvious thing.
          */
         auto mevt = reinterpret_cast<const clap_event_midi *>(evt);
+        if ((mevt->data[0] & 0xF0) == 0x90 && mevt->data[2] > 0)
+            makeRoomForNote(mevt->data[1]);
         sst::voicemanager::applyMidi1Message(voiceManager, mevt->port_index, mevt->data);
         break;
     }
     /*
-     * CLAP_EVENT_NOTE_ON and OFF simply deliver the event to the note creators below,
-     * which find (probably) and activate a spare or playing voice. Our 'voice stealing'
-     * algorithm here is 'just don't play a note 65 if 64 are ringing. Remember this is an
-     * example synth!
+     * CLAP_EVENT_NOTE_ON and OFF deliver the event to the note creators below, which
+     * activate a spare voice. Before a note on reaches them makeRoomForNote steals a
+     * voice if every one is sounding, so initializeVoice always finds one free.
      */
     case CLAP_EVENT_NOTE_ON:
     {
         auto nevt = reinterpret_cast<const clap_event_note *>(evt);
+        makeRoomForNote(nevt->key);
         voiceManager.processNoteOnEvent(nevt->port_index, nevt->channel, nevt->key, nevt->note_id,
                                         nevt->velocity, 0.f);
     }
@@ -932,24 +1423,35 @@ void ConduitPolysynth::handleInboundEvent(const clap_event_header_t *evt)
 PolysynthVoice *ConduitPolysynth::initializeVoice(uint16_t port, uint16_t channel, uint16_t key,
                                                   int32_t noteId, float velocity, float retune)
 {
-    for (auto &v : voices)
-    {
-        if (!v.active)
-        {
-            activateVoice(v, port, channel, key, noteId, velocity);
+    if (nFreeVoices == 0)
+        return nullptr;
 
-            if (clapJuceShim->isEditorAttached())
-            {
-                auto r = ToUI();
-                r.type = ToUI::MIDI_NOTE_ON;
-                r.id = (uint32_t)key;
-                uiComms.toUiQ.push(r);
-            }
+    auto &v = *freeVoices[--nFreeVoices];
+    v.activeIndex = nActiveVoices;
+    activeVoices[nActiveVoices++] = &v;
 
-            return &v;
-        }
+    activateVoice(v, port, channel, key, noteId, velocity);
+
+    if (clapJuceShim->isEditorAttached())
+    {
+        auto r = ToUI();
+        r.type = ToUI::MIDI_NOTE_ON;
+        r.id = (uint32_t)key;
+        uiComms.toUiQ.push(r);
     }
-    return nullptr;
+
+    return &v;
+}
+
+void ConduitPolysynth::retireVoice(PolysynthVoice &v)
+{
+    assert(v.activeIndex >= 0 && activeVoices[v.activeIndex] == &v);
+    auto last = activeVoices[--nActiveVoices];
+    activeVoices[v.activeIndex] = last;
+    last->activeIndex = v.activeIndex;
+    v.activeIndex = -1;
+
+    freeVoices[nFreeVoices++] = &v;
 }
 
 void ConduitPolysynth::releaseVoice(PolysynthVoice *sdv, float velocity)
@@ -958,6 +1460,8 @@ void ConduitPolysynth::releaseVoice(PolysynthVoice *sdv, float velocity)
     {
         sdv->releaseVelocity = velocity;
         sdv->release();
+        if (!sdv->stolen && !sdv->linked[PolysynthVoice::linkReleased])
+            releasedVoices.pushBack(*sdv);
 
         if (clapJuceShim->isEditorAttached())
         {
@@ -972,8 +1476,223 @@ void ConduitPolysynth::releaseVoice(PolysynthVoice *sdv, float velocity)
 void ConduitPolysynth::activateVoice(PolysynthVoice &v, int port_index, int channel, int key,
                                      int noteid, double velocity)
 {
+    tuning.watchChannel(channel);
     v.start(port_index, channel, key, noteid, velocity);
-    uiComms.dataCopyForUI.polyphony++;
+    v.startSerial = ++voiceStartSerial;
+    soundingVoices.pushBack(v);
+    voicesByKey[v.key & 127].pushBack(v);
+    nSoundingVoices++;
+    liveTelemetry().polyphony++;
+}
+
+void ConduitPolysynth::makeRoomForNote(int key)
+{
+    if (nSoundingVoices >= polyphony)
+    {
+        if (auto victim = chooseStealVictim(key))
+        {
+            stealVoice(*victim);
+            liveTelemetry().voicesStolen++;
+        }
+    }
+
+    // Every spare voice is still fading from an earlier steal, so cut the oldest fade short
+    if (nFreeVoices == 0 && fadingVoices.head)
+    {
+        auto &v = *fadingVoices.head;
+        fadingVoices.remove(v);
+        v.active = false;
+        retireVoice(v);
+    }
+}
+
+PolysynthVoice *ConduitPolysynth::chooseStealVictim(int key)
+{
+    auto policy = (int)std::round(patch.params[patchIndexOf(pmStealPolicy)]);
+    switch (policy)
+    {
+    case stealQuietest:
+        return quietestVoice();
+    case stealSameKey:
+        if (voicesByKey[key & 127].head)
+            return voicesByKey[key & 127].head;
+        [[fallthrough]];
+    case stealReleasedFirst:
+        if (releasedVoices.head)
+            return releasedVoices.head;
+        break;
+    default:
+        break;
+    }
+    return soundingVoices.head;
+}
+
+PolysynthVoice *ConduitPolysynth::quietestVoice()
+{
+    auto louder = [](const QuietEntry &a, const QuietEntry &b) { return a.level > b.level; };
+    auto heapEnd = [this]() { return quietHeap.begin() + quietHeapSize; };
+
+    if (!quietHeapValid)
+    {
+        quietHeapSize = 0;
+        for (auto v = soundingVoices.head; v; v = v->linkNext[PolysynthVoice::linkAge])
+            quietHeap[quietHeapSize++] = {v->aeg.outBlock0, v->startSerial, v};
+        std::make_heap(quietHeap.begin(), heapEnd(), louder);
+        quietHeapValid = true;
+    }
+
+    while (quietHeapSize > 0)
+    {
+        std::pop_heap(quietHeap.begin(), heapEnd(), louder);
+        auto &e = quietHeap[--quietHeapSize];
+        auto *v = e.voice;
+        if (v->startSerial == e.serial && v->linked[PolysynthVoice::linkAge] && !v->stolen)
+            return v;
+    }
+    return soundingVoices.head;
+}
+
+void ConduitPolysynth::stealVoice(PolysynthVoice &v)
+{
+    voiceStopped(v);
+    fadingVoices.pushBack(v);
+    v.beginStealFade(stealFadeSeconds);
+
+    // As far as the host and the voice manager know the note ends now
+    terminatedVoices.emplace_back(v.portid, v.channel, v.key, v.note_id);
+    voiceEndCallback(&v);
+}
+
+void ConduitPolysynth::adaptToRenderLoad(uint32_t frames)
+{
+    auto load = renderLoadMeter.end(frames, sampleRate);
+    auto limit = patch.params[patchIndexOf(pmRenderLoadLimit)];
+    secondsSinceUnisonCapChange += frames * dsamplerate_inv;
+    secondsSinceShed += frames * dsamplerate_inv;
+
+    auto &dc = liveTelemetry();
+    if (renderOffline)
+    {
+        unisonCap = PolysynthVoice::max_uni;
+    }
+    else if (load > limit)
+    {
+        dc.blocksOverLimit++;
+        if (renderLoadMeter.blockLoad > limit && secondsSinceShed >= shedIntervalSeconds)
+        {
+            shedReleasedVoices();
+            secondsSinceShed = 0;
+        }
+
+        // Start from the patch's count so the first step down actually saves something
+        auto patchUnison = (int)patch.params[patchIndexOf(pmSawUnisonCount)];
+        if (unisonCap > 1 && secondsSinceUnisonCapChange >= unisonCapDownSeconds)
+        {
+            unisonCap = std::max(1, std::min(unisonCap, patchUnison) / 2);
+            secondsSinceUnisonCapChange = 0;
+        }
+    }
+    else if (unisonCap < PolysynthVoice::max_uni && load < limit * loadRecoveredRatio &&
+             secondsSinceUnisonCapChange >= unisonCapUpSeconds)
+    {
+        unisonCap = std::min(unisonCap * 2, PolysynthVoice::max_uni);
+        secondsSinceUnisonCapChange = 0;
+    }
+
+    dc.renderLoad = load;
+    dc.peakRenderLoad = renderLoadMeter.peak;
+    dc.unisonCap = unisonCap < PolysynthVoice::max_uni ? unisonCap : 0;
+}
+
+void ConduitPolysynth::shedReleasedVoices()
+{
+    // The quiet heap's storage is free until the next quietest steal rebuilds it
+    quietHeapValid = false;
+    quietHeapSize = 0;
+
+    auto n = 0;
+    for (auto v = releasedVoices.head; v; v = v->linkNext[PolysynthVoice::linkReleased])
+        quietHeap[n++] = {v->aeg.outBlock0, v->startSerial, v};
+    if (n == 0)
+        return;
+
+    // The quietest quarter, and at least one, of the voices already in release
+    auto nShed = std::max(1, n / 4);
+    std::nth_element(quietHeap.begin(), quietHeap.begin() + nShed - 1, quietHeap.begin() + n,
+                     [](const auto &a, const auto &b) { return a.level < b.level; });
+    for (auto i = 0; i < nShed; ++i)
+        stealVoice(*quietHeap[i].voice);
+    liveTelemetry().voicesShed += nShed;
+}
+
+bool ConduitPolysynth::renderLoadGet(const clap_plugin_t *plugin, conduit_render_load_t *load)
+{
+    auto self = static_cast<ConduitPolysynth *>(plugin->plugin_data);
+    auto dc = self->uiComms.dataCopyForUI.telemetry.read();
+    load->load = dc.renderLoad;
+    load->peakLoad = dc.peakRenderLoad;
+    load->voicesShed = dc.voicesShed;
+    load->unisonCap = dc.unisonCap;
+    load->blocksOverLimit = dc.blocksOverLimit;
+    return true;
+}
+
+const void *ConduitPolysynth::extension(const char *id) noexcept
+{
+    if (!strcmp(id, CONDUIT_EXT_RENDER_LOAD))
+        return &renderLoadExtension;
+    return ClapBaseClass::extension(id);
+}
+
+void ConduitPolysynth::voiceStopped(PolysynthVoice &v)
+{
+    soundingVoices.remove(v);
+    if (v.linked[PolysynthVoice::linkReleased])
+        releasedVoices.remove(v);
+    voicesByKey[v.key & 127].remove(v);
+    nSoundingVoices--;
+}
+
+void ConduitPolysynth::resetVoiceLists()
+{
+    soundingVoices.clear();
+    fadingVoices.clear();
+    releasedVoices.clear();
+    for (auto &l : voicesByKey)
+        l.clear();
+    nSoundingVoices = 0;
+    quietHeapSize = 0;
+    quietHeapValid = false;
+}
+
+void ConduitPolysynth::VoiceList::pushBack(PolysynthVoice &v)
+{
+    assert(!v.linked[link]);
+    v.linkPrev[link] = tail;
+    v.linkNext[link] = nullptr;
+    if (tail)
+        tail->linkNext[link] = &v;
+    else
+        head = &v;
+    tail = &v;
+    v.linked[link] = true;
+}
+
+void ConduitPolysynth::VoiceList::remove(PolysynthVoice &v)
+{
+    assert(v.linked[link]);
+    auto prev = v.linkPrev[link], next = v.linkNext[link];
+    if (prev)
+        prev->linkNext[link] = next;
+    else
+        head = next;
+    if (next)
+        next->linkPrev[link] = prev;
+    else
+        tail = prev;
+    v.linkPrev[link] = nullptr;
+    v.linkNext[link] = nullptr;
+    v.linked[link] = false;
 }
 
 /*
@@ -994,6 +1713,7 @@ void ConduitPolysynth::paramsFlush(const clap_input_events *in,
     }
 
     auto ct = handleEventsFromUIQueue(out);
+    patchIOHandler.applyNow();
 
     if (ct)
         pushParamsToVoices();
@@ -1022,6 +1742,7 @@ void ConduitPolysynth::handleSpecializedFromUI(const FromUI &r)
         rt.target = (ConduitPolysynth::paramIds)sm.tgt;
         rt.depth = sm.depth;
         uiComms.dataCopyForUI.populateMatrixView(patch.extension.modMatrixConfig);
+        compileModProgram();
     }
     else if (std::holds_alternative<smt::MPEConfig>(smw.payload))
     {
@@ -1034,6 +1755,78 @@ void ConduitPolysynth::handleSpecializedFromUI(const FromUI &r)
     }
 }
 
+namespace
+{
+int modSourceIndex(ModMatrixConfig::Sources s)
+{
+    switch (s)
+    {
+    case ModMatrixConfig::LFO1:
+        return PolysynthVoice::msLFO1;
+    case ModMatrixConfig::LFO2:
+        return PolysynthVoice::msLFO2;
+    case ModMatrixConfig::AEG:
+        return PolysynthVoice::msAEG;
+    case ModMatrixConfig::FEG:
+        return PolysynthVoice::msFEG;
+    case ModMatrixConfig::Velocity:
+        return PolysynthVoice::msVelocity;
+    case ModMatrixConfig::ReleaseVelocity:
+        return PolysynthVoice::msReleaseVelocity;
+    case ModMatrixConfig::ModWheel:
+        return PolysynthVoice::msModWheel;
+    case ModMatrixConfig::PolyAT:
+        return PolysynthVoice::msPolyAT;
+    case ModMatrixConfig::ChannelAT:
+        return PolysynthVoice::msChannelAT;
+    case ModMatrixConfig::MPETimbre:
+        return PolysynthVoice::msMPETimbre;
+    case ModMatrixConfig::MPEPressure:
+        return PolysynthVoice::msMPEPressure;
+    default:
+        return -1;
+    }
+}
+} // namespace
+
+void ConduitPolysynth::compileModProgram()
+{
+    auto &p = modProgram;
+    p.nOps = 0;
+    p.nTargets = 0;
+
+    auto targetIndex = [&p](int slot) {
+        for (int t = 0; t < p.nTargets; ++t)
+            if (p.targetSlots[t] == slot)
+                return t;
+        p.targetSlots[p.nTargets] = slot;
+        return p.nTargets++;
+    };
+
+    // The voice adds the feg and keytrack to the cutoffs after the matrix, so the program
+    // writes both every block even when nothing is routed to them
+    targetIndex(PolysynthVoice::modSlotFor(pmSVFCutoff));
+    targetIndex(PolysynthVoice::modSlotFor(pmLPFCutoff));
+
+    for (const auto &r : patch.extension.modMatrixConfig->routings)
+    {
+        auto source = modSourceIndex(r.source);
+        auto slot = PolysynthVoice::modSlotFor(r.target);
+        if (source < 0 || slot < 0)
+            continue;
+
+        auto via = modSourceIndex(r.via);
+        const auto &pd = paramDescriptions[paramIndexOf(r.target)];
+
+        auto &op = p.ops[p.nOps++];
+        op.source = (uint8_t)source;
+        op.via = (uint8_t)(via < 0 ? PolysynthVoice::msOne : via);
+        op.target = (uint8_t)targetIndex(slot);
+        op.depth = r.depth * (pd.maxVal - pd.minVal);
+    }
+    p.generation++;
+}
+
 void ConduitPolysynthConfig::DataCopyForUI::populateMatrixView(
     const std::unique_ptr<ModMatrixConfig> &c)
 {
@@ -1046,25 +1839,49 @@ void ConduitPolysynthConfig::DataCopyForUI::populateMatrixView(
     rescanMatrix++;
 }
 
-bool ConduitPolysynthConfig::PatchExtension::toXml(TiXmlElement &root)
+bool ConduitPolysynthConfig::PatchExtension::toBinary(shared::StateWriter &w) const
+{
+    w.u32(ModMatrixConfig::nModSlots);
+    for (const auto &el : modMatrixConfig->routings)
+    {
+        w.i32(el.source);
+        w.i32(el.via);
+        w.i32(el.target);
+        w.f32(el.depth);
+    }
+    return true;
+}
+
+bool ConduitPolysynthConfig::PatchExtension::fromBinary(shared::StateReader &r)
 {
-    TiXmlElement matrix("matrix");
+    uint32_t n;
+    if (!r.u32(n))
+        return false;
 
-    int idx{0};
-    for (auto &el : modMatrixConfig->routings)
+    // As with xml, a patch from a smaller matrix leaves the rest of the rows empty
+    for (auto &rto : modMatrixConfig->routings)
     {
-        TiXmlElement rt("routing");
-        rt.SetAttribute("idx", idx);
-        rt.SetAttribute("source", el.source);
-        rt.SetAttribute("via", el.via);
-        rt.SetAttribute("target", el.target);
-        rt.SetDoubleAttribute("depth", el.depth);
-
-        matrix.InsertEndChild(rt);
-        idx++;
+        rto.source = ModMatrixConfig::NONE;
+        rto.via = ModMatrixConfig::NONE;
+        rto.target = ConduitPolysynth::pmNoModTarget;
+        rto.depth = 0.f;
     }
+    for (auto idx = 0U; idx < n; ++idx)
+    {
+        int32_t s, v, t;
+        float d;
+        if (!r.i32(s) || !r.i32(v) || !r.i32(t) || !r.f32(d))
+            return false;
 
-    root.InsertEndChild(matrix);
+        if (idx < ModMatrixConfig::nModSlots)
+        {
+            auto &rto = modMatrixConfig->routings[idx];
+            rto.source = (ModMatrixConfig::Sources)s;
+            rto.via = (ModMatrixConfig::Sources)v;
+            rto.target = (ConduitPolysynth::paramIds)t;
+            rto.depth = d;
+        }
+    }
     return true;
 }
 
@@ -1077,6 +1894,15 @@ bool ConduitPolysynthConfig::PatchExtension::fromXml(TiXmlElement *root)
 
     auto rt = TINYXML_SAFE_TO_ELEMENT(matrix->FirstChild("routing"));
 
+    // Older patches have fewer rows than we do now, so clear everything first
+    for (auto &rto : modMatrixConfig->routings)
+    {
+        rto.source = ModMatrixConfig::NONE;
+        rto.via = ModMatrixConfig::NONE;
+        rto.target = ConduitPolysynth::pmNoModTarget;
+        rto.depth = 0.f;
+    }
+
     while (rt)
     {
         int idx{-1}, s{ModMatrixConfig::Sources::NONE}, v{ModMatrixConfig::Sources::NONE},
@@ -1089,7 +1915,7 @@ bool ConduitPolysynthConfig::PatchExtension::fromXml(TiXmlElement *root)
         rt->QueryIntAttribute("target", &t);
         rt->QueryDoubleAttribute("depth", &d);
 
-        if (idx >= 0)
+        if (idx >= 0 && idx < ModMatrixConfig::nModSlots)
         {
             auto &rto = modMatrixConfig->routings[idx];
             rto.source = (ModMatrixConfig::Sources)s;
@@ -1106,6 +1932,7 @@ bool ConduitPolysynthConfig::PatchExtension::fromXml(TiXmlElement *root)
 void ConduitPolysynth::onStateRestored()
 {
     uiComms.dataCopyForUI.populateMatrixView(patch.extension.modMatrixConfig);
+    modProgramDirty = true;
 }
 
 } // namespace sst::conduit::polysynth
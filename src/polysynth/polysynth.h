@@ -22,6 +22,7 @@
 #ifndef CONDUIT_SRC_POLYSYNTH_POLYSYNTH_H
 #define CONDUIT_SRC_POLYSYNTH_POLYSYNTH_H
 
+#include <algorithm>
 #include <iostream>
 #include <unordered_map>
 #include <vector>
@@ -33,7 +34,6 @@
 #include <array>
 #include <unordered_map>
 #include <memory>
-#include <random>
 #include <tuple>
 
 #include <clap/helpers/plugin.hh>
@@ -42,25 +42,29 @@
 
 #include "sst/basic-blocks/params/ParamMetadata.h"
 #include "sst/basic-blocks/dsp/VUPeak.h"
-#include "sst/filters/HalfRateFilter.h"
 #include "sst/voicemanager/voicemanager.h"
 
 #include "sst/effects/Phaser.h"
 #include "sst/effects/Flanger.h"
 #include "sst/effects/Reverb1.h"
 
+#include "conduit-shared/block-noise.h"
 #include "conduit-shared/clap-base-class.h"
+#include "conduit-shared/mts-tuning.h"
+#include "conduit-shared/oversampling.h"
+#include "conduit-shared/render-load.h"
+#include "conduit-shared/task-pool.h"
+#include "conduit-shared/telemetry.h"
 #include "voice.h"
 
-struct MTSClient;
-
 namespace sst::conduit::polysynth
 {
 /*
  * This static (defined in the cpp file) allows us to present a name, feature set,
  * url etc... and is consumed by clap-saw-demo-pluginentry.cpp
  */
-static constexpr int nParams{72};
+static constexpr int nParams{80};
+static constexpr int nModMatrixSlots{32};
 
 struct ModMatrixConfig;
 
@@ -74,35 +78,46 @@ struct ConduitPolysynthConfig
     {
         static constexpr bool hasExtension{true};
 
+        // every extension owns a matrix, including those the patch io thread parses into
+        PatchExtension() { initialize(); }
         void initialize();
         std::unique_ptr<ModMatrixConfig> modMatrixConfig;
 
-        bool toXml(TiXmlElement &);
+        bool toBinary(sst::conduit::shared::StateWriter &) const;
+        bool fromBinary(sst::conduit::shared::StateReader &);
+        // patches from before the binary state
         bool fromXml(TiXmlElement *);
 
         bool mpeMode{false};
     };
+    // What process reports, published once a block through DataCopyForUI::telemetry
+    struct Telemetry
+    {
+        int polyphony{0};
+        uint32_t voicesStolen{0};
+
+        // what process has done to keep up; see ConduitPolysynth::adaptToRenderLoad
+        float renderLoad{0.f}, peakRenderLoad{0.f};
+        uint32_t voicesShed{0}, unisonCap{0}, blocksOverLimit{0};
+        // released voices ended early because they had gone silent
+        uint32_t voicesSilenced{0};
+
+        float mainVU[2]{};
+        sst::conduit::shared::TransportTelemetry transport;
+    };
+
     struct DataCopyForUI
     {
         std::atomic<uint32_t> updateCount{0};
         std::atomic<bool> isProcessing{false};
-        std::atomic<int> polyphony{0};
 
-        std::atomic<float> mainVU[2];
+        sst::conduit::shared::Telemetry<Telemetry> telemetry;
 
         // s1, s2, target, depth
         using modMessage = std::tuple<int32_t, int32_t, int32_t, float>;
-        std::array<modMessage, 8> modMatrixCopy;
+        std::array<modMessage, nModMatrixSlots> modMatrixCopy;
         std::atomic<uint32_t> rescanMatrix{0};
 
-        std::atomic<bool> isPlayingOrRecording;
-        std::atomic<double> tempo;
-        std::atomic<clap_beattime> bar_start;
-        std::atomic<int32_t> bar_number;
-        std::atomic<clap_beattime> song_pos_beats;
-
-        std::atomic<uint16_t> tsig_num, tsig_denom;
-
         void populateMatrixView(const std::unique_ptr<ModMatrixConfig> &);
     };
 
@@ -137,12 +152,16 @@ using ReverbFX = sst::effects::reverb1::Reverb1<Reverb1Config>;
 struct ConduitPolysynth
     : sst::conduit::shared::ClapBaseClass<ConduitPolysynth, ConduitPolysynthConfig>
 {
-    static constexpr int max_voices = 64;
+    static constexpr int max_voices = 256; // the most pmPolyphony can ask for
+    // stolen voices fading out, on top of pmPolyphony; see stealReserveFor
+    static constexpr int max_steal_fades = 16;
+    static constexpr int max_pool = max_voices + max_steal_fades;
     ConduitPolysynth(const clap_host *host);
     ~ConduitPolysynth();
 
     bool activate(double sampleRate, uint32_t minFrameCount,
                   uint32_t maxFrameCount) noexcept override;
+    void deactivate() noexcept override;
 
     enum paramIds : uint32_t
     {
@@ -235,6 +254,23 @@ struct ConduitPolysynth
         // and finally the main level
         pmOutputLevel = 20100,
 
+        // Voice count; changing it needs a restart as activate sizes the voice pool
+        pmPolyphony = 20200,
+        // Voice render rate; auto is 2x with the waveshaper on and 1x otherwise
+        pmOversampling,
+        // Which voice a note takes once every voice is sounding; a StealPolicy
+        pmStealPolicy,
+        // The share of the real time budget past which process starts to shed work
+        pmRenderLoadLimit,
+        // A released voice quieter than this many dBFS for a moment is ended
+        pmReleaseSilenceFloor,
+        // Run the effects a block behind the voices on a worker; needs a restart
+        pmFXPipeline,
+        // How many threads share the voice rendering; needs a restart
+        pmRenderThreads,
+        // The seed for all our randomness, or 0 for this instance's own; needs a restart
+        pmRandomSeed,
+
         // Special parameter indicating no modulation target
         pmNoModTarget = 0x0100BEEF
     };
@@ -243,6 +279,102 @@ struct ConduitPolysynth
     static constexpr int offPmLFO2{100};
     static constexpr int n_lfos{2};
 
+    /*
+     * The ids in the order the constructor pushes their descriptions, which is also
+     * the order of patch.params. The constructor asserts the two agree, so code which
+     * knows an id at compile time can use patchIndexOf rather than paramIndexOf and
+     * index patch.params directly. If you add a param, add it here in the same spot.
+     */
+    static constexpr std::array<uint32_t, nParams> patchOrder{
+        pmSawActive,
+        pmSawUnisonCount,
+        pmSawUnisonSpread,
+        pmSawCoarse,
+        pmSawFine,
+        pmSawLevel,
+        pmPWActive,
+        pmPWWidth,
+        pmPWFrequencyDiv,
+        pmPWCoarse,
+        pmPWFine,
+        pmPWLevel,
+        pmSinActive,
+        pmSinFrequencyDiv,
+        pmSinCoarse,
+        pmSinLevel,
+        pmNoiseActive,
+        pmNoiseColor,
+        pmNoiseLevel,
+        pmLPFActive,
+        pmLPFCutoff,
+        pmLPFResonance,
+        pmLPFFilterMode,
+        pmLPFKeytrack,
+        pmSVFActive,
+        pmSVFCutoff,
+        pmSVFResonance,
+        pmSVFFilterMode,
+        pmSVFKeytrack,
+        pmWSActive,
+        pmWSDrive,
+        pmWSBias,
+        pmWSMode,
+        pmFilterRouting,
+        pmFilterFeedback,
+        pmEnvA,
+        pmEnvD,
+        pmEnvS,
+        pmEnvR,
+        pmAegVelocitySens,
+        pmAegPreFilterGain,
+        pmEnvA + offPmFeg,
+        pmEnvD + offPmFeg,
+        pmEnvS + offPmFeg,
+        pmEnvR + offPmFeg,
+        pmFegToLPFCutoff,
+        pmFegToSVFCutoff,
+        pmLFOActive,
+        pmLFORate,
+        pmLFOTempoSync,
+        pmLFODeform,
+        pmLFOAmplitude,
+        pmLFOShape,
+        pmLFOActive + offPmLFO2,
+        pmLFORate + offPmLFO2,
+        pmLFOTempoSync + offPmLFO2,
+        pmLFODeform + offPmLFO2,
+        pmLFOAmplitude + offPmLFO2,
+        pmLFOShape + offPmLFO2,
+        pmVoicePan,
+        pmVoiceLevel,
+        pmModFXActive,
+        pmModFXType,
+        pmModFXPreset,
+        pmModFXRate,
+        pmModFXRateTemposync,
+        pmModFXMix,
+        pmRevFXActive,
+        pmRevFXPreset,
+        pmRevFXTime,
+        pmRevFXMix,
+        pmOutputLevel,
+        pmPolyphony,
+        pmOversampling,
+        pmStealPolicy,
+        pmRenderLoadLimit,
+        pmReleaseSilenceFloor,
+        pmFXPipeline,
+        pmRenderThreads,
+        pmRandomSeed};
+
+    static constexpr int patchIndexOf(uint32_t id)
+    {
+        for (auto i = 0U; i < patchOrder.size(); ++i)
+            if (patchOrder[i] == id)
+                return (int)i;
+        return -1;
+    }
+
   public:
     /*
      * Many CLAP plugins will want input and output audio and note ports, although
@@ -268,12 +400,30 @@ struct ConduitPolysynth
     bool implementsVoiceInfo() const noexcept override { return true; }
     bool voiceInfoGet(clap_voice_info *info) noexcept override
     {
-        info->voice_capacity = max_voices;
-        info->voice_count = max_voices;
+        info->voice_capacity = polyphony;
+        info->voice_count = polyphony;
         info->flags = CLAP_VOICE_INFO_SUPPORTS_OVERLAPPING_NOTES;
         return true;
     }
 
+    /*
+     * Our tail is the effects ringing on after the last voice ends. Once no voice has
+     * sounded for that long and the output is silent, process sleeps, and skips the
+     * voices and effects entirely until a note or another event arrives.
+     */
+    bool implementsTail() const noexcept override { return true; }
+    static constexpr double modFXTailSeconds{0.5};
+    uint32_t effectsTailSamples() const;
+
+    /*
+     * The effects run on their own bus; see runEffectsBus. Our latency is how far the bus
+     * output trails the voices, which is none unless pmFXPipeline is on, and is fixed at
+     * activate.
+     */
+    static constexpr int fxBlockSize{4 * PolysynthVoice::blockSize};
+    bool implementsLatency() const noexcept override { return true; }
+    uint32_t latencyGet() const noexcept override { return fxLatency; }
+
     /*
      * process is the meat of the operation. It does obvious things like trigger
      * voices but also handles all the polyphonic modulation and so on. Please see the
@@ -313,8 +463,31 @@ struct ConduitPolysynth
 
     uint32_t getAsVst3SupportedNodeExpressions() override { return AS_VST3_NOTE_EXPRESSION_ALL; }
 
-    std::default_random_engine gen;
-    std::uniform_real_distribution<float> urd;
+    /*
+     * Voices can optionally render in parallel; see renderVoices. We prefer the host's
+     * thread pool when it offers one, and threadPoolExec is how it calls us back.
+     */
+    bool implementsThreadPool() const noexcept override { return true; }
+    void threadPoolExec(uint32_t taskIndex) noexcept override
+    {
+        shared::rtcheck::AudioThreadScope rtScope;
+        renderVoiceTask(taskIndex);
+    }
+
+    /*
+     * All our randomness, the effects' rand01 here and each voice's noise, comes from
+     * BlockRNGs seeded from randomSeed, so a render with the same events is repeatable.
+     * Voice i is seeded with randomSeed + 1 + i. Each instance has a seed of its own, so
+     * two of them don't play the same noise, which pmRandomSeed replaces when it isn't 0.
+     * activate reseeds everything from one or the other. Set it while deactivated.
+     */
+    sst::conduit::shared::BlockRNG rng;
+    const uint64_t instanceSeed{nextInstanceSeed()};
+    uint64_t randomSeed{instanceSeed};
+    int randomSeedParam{0}; // the pmRandomSeed activate took up
+    void setRandomSeed(uint64_t seed);
+    static uint64_t nextInstanceSeed();
+    static constexpr int maxRandomSeedParam{1 << 24}; // every int to here is exact as a float
 
     void onStateRestored() override;
 
@@ -326,11 +499,72 @@ struct ConduitPolysynth
   private:
     typedef std::unordered_map<int, int> PatchPluginExtension;
 
-    uint16_t blockPos{0};
-    void renderVoices();
-    float output alignas(16)[2][PolysynthVoice::blockSize];
+    uint32_t blockPos{0};
+    void renderVoices(float *intoL, float *intoR);
+    void renderVoiceBlock();
     float outputOS alignas(16)[2][PolysynthVoice::blockSizeOS];
-    sst::filters::HalfRate::HalfRateFilter hr_dn;
+
+    /*
+     * Voices render blockSizeOS samples at sampleRate * oversampler.factor(), which is
+     * blockSizeOS >> factorLog2 samples at our rate once decimated. rendered holds those
+     * and output is filled from it a block at a time; updateOversampling moves the voices
+     * to a new rate when the mode or the waveshaper changes.
+     */
+    sst::conduit::shared::Oversampler<PolysynthVoice::blockSizeOS> oversampler;
+    float rendered alignas(16)[2][PolysynthVoice::blockSizeOS];
+    int renderedPos{0}, renderedCount{0};
+    void updateOversampling(bool force);
+
+    /*
+     * Parallel voice rendering splits the playing voices into up to renderThreads
+     * contiguous ranges. Each task renders its range into its own oversampled buffer and
+     * we sum those in task order, so the output doesn't depend on which thread ran what.
+     * renderThreads is taken from pmRenderThreads at activation and is 1 (serial) by
+     * default.
+     */
+    static constexpr int maxRenderTasks{8};
+    static constexpr int minVoicesPerRenderTask{4};
+    int renderThreads{1};
+    std::unique_ptr<sst::conduit::shared::TaskPool> renderPool;
+    std::array<PolysynthVoice *, max_pool> renderList{};
+    int renderListSize{0}, nRenderTasks{1};
+    float taskOutputOS alignas(16)[maxRenderTasks][2][PolysynthVoice::blockSizeOS];
+
+    /*
+     * The mod matrix as voices run it. Only the audio thread compiles it, so a routing
+     * change from the UI compiles straight away and a state restore, which arrives on
+     * the main thread, sets modProgramDirty for the next process to pick up.
+     */
+    ModProgram modProgram;
+    std::atomic<bool> modProgramDirty{false};
+    void compileModProgram();
+
+    /*
+     * The effects bus. The effects run on fxBlockSize samples at a time, so they pay their
+     * per block setup a quarter as often as they would inline. At each bus boundary the
+     * voices render a whole bus block ahead and the effects run on it straight away, so
+     * there is no latency; the price is that events reach the voices on bus boundaries,
+     * fxBlockSize apart, rather than every voice block.
+     *
+     * With pmFXPipeline on, voices instead fill a bus block a voice block at a time, a full
+     * one goes to fxWorker and we read it back one bus block later, so the effects of one
+     * block run while the voices render the next. The output trails the voices by
+     * 2 * fxBlockSize - blockSize samples, which is our latency. That takes a third bus
+     * block, so the voices, the worker and the output each have one of their own.
+     */
+    static_assert(fxBlockSize % PolysynthVoice::blockSize == 0);
+    float busBlocks alignas(16)[3][2][fxBlockSize];
+    int busPos{0}, busReadPos{0}, busFillBlock{0}, busRunBlock{1}, busReadBlock{2};
+    bool fxPipelined{false}, fxModActive{false}, fxRevActive{false}, fxUsePhaser{true};
+    uint32_t fxLatency{0};
+    std::unique_ptr<sst::conduit::shared::PipelineWorker> fxWorker;
+    void resetEffectsBus();
+    void advanceEffectsBus();
+    void runEffectsBus(float (&block)[2][fxBlockSize]);
+
+    void renderVoiceTask(uint32_t task);
+    void renderVoiceRange(PolysynthVoice **vs, int n,
+                          float (&into)[2][PolysynthVoice::blockSizeOS]);
 
     // Voice Management
     struct VMConfig
@@ -399,19 +633,197 @@ struct ConduitPolysynth
 
     void handleSpecializedFromUI(const FromUI &r);
 
-    MTSClient *mtsClient{nullptr};
+    /*
+     * Voices only recompute pitch when one of their inputs moves, and a retune from the MTS
+     * master is one of those inputs. process refreshes the snapshot once per call and a
+     * voice compares its generation with the one it last tuned to.
+     */
+    sst::conduit::shared::MTSTuningSnapshot tuning;
 
     std::unique_ptr<PhaserFX> phaserFX;
     std::unique_ptr<FlangerFX> flangerFX;
     std::unique_ptr<ReverbFX> reverbFX;
 
+    /*
+     * What the effect configs in effects-impl.h read, copied from the patch once per bus
+     * block so each value the effects ask for is a field load. The preset rows are found
+     * again only when a preset parameter moves.
+     */
+    struct FXParams
+    {
+        float modMix{0.f}, modRate{0.f}, revMix{0.f}, revTime{0.f};
+        float modPreset{-1.f}, revPreset{-1.f};
+        const double *phaserPreset{nullptr}, *flangerPreset{nullptr}, *reverbPreset{nullptr};
+    } fxParams;
+    void snapshotFXParams();
+
     sst::basic_blocks::dsp::VUPeak mainVU;
 
   private:
     using voiceManager_t = sst::voicemanager::VoiceManager<VMConfig, ConduitPolysynth>;
     voiceManager_t voiceManager;
 
-    std::array<PolysynthVoice, max_voices> voices;
+    /*
+     * The voices live in one cache line aligned block, sized at activate from
+     * pmPolyphony, and constructed in place since a voice holds pointers to itself.
+     */
+    struct VoicePool
+    {
+        PolysynthVoice *data{nullptr};
+        int count{0};
+
+        void allocate(ConduitPolysynth &synth, int n);
+        void release();
+        ~VoicePool() { release(); }
+
+        int size() const { return count; }
+        PolysynthVoice &operator[](int i) { return data[i]; }
+        PolysynthVoice *begin() { return data; }
+        PolysynthVoice *end() { return data + count; }
+    } voices;
+    bool restartRequested{false};
+
+  public:
+    /*
+     * The comb LPF needs a pair of long delay lines per voice, which would dwarf the
+     * rest of a voice, so they come from an arena we only allocate once a patch picks
+     * the comb. That happens on the main thread, either at activate or in onMainThread
+     * after process notices the selection. Until it is published, voices which
+     * ask for a comb run without the LPF.
+     */
+    static constexpr size_t combLineSize{sst::filters::utilities::MAX_FB_COMB +
+                                         sst::filters::utilities::SincTable::FIRipol_N};
+    float *combDelayLinesFor(const PolysynthVoice &v) const
+    {
+        auto arena = combArena.load(std::memory_order_acquire);
+        return arena ? arena + v.poolIndex * 2 * combLineSize : nullptr;
+    }
+
+  private:
+    std::unique_ptr<float[]> combArenaStorage;
+    std::atomic<float *> combArena{nullptr};
+    std::atomic<bool> combArenaRequested{false};
+    void allocateCombArena();
+    bool patchUsesComb() const;
+    void onMainThread() noexcept override;
+
+    /*
+     * The playing voices and the idle ones, so note on, render and the termination
+     * scan cost what is playing rather than max_voices. Each voice knows its own
+     * position in activeVoices which makes removal a swap with the last entry.
+     */
+    std::array<PolysynthVoice *, max_pool> activeVoices{}, freeVoices{};
+    int nActiveVoices{0}, nFreeVoices{0};
+    void retireVoice(PolysynthVoice &v);
+
+    /*
+     * Voice stealing. At most polyphony voices sound at once; the pool holds a few more
+     * so that a stolen voice can fade out over stealFadeSeconds while the new note takes
+     * a fresh voice. The victim comes off the front of one of the lists below, so
+     * choosing one is O(1) for every policy but quietest, which keeps a heap by level.
+     */
+    enum StealPolicy : uint32_t
+    {
+        stealOldest = 0,
+        stealQuietest,
+        stealSameKey,
+        stealReleasedFirst
+    };
+    static constexpr float stealFadeSeconds{0.005f};
+    static int stealReserveFor(int polyphony)
+    {
+        return std::clamp(polyphony / 4, 2, max_steal_fades);
+    }
+
+    // A doubly linked list through one of the PolysynthVoice::VoiceLink slots, oldest first
+    struct VoiceList
+    {
+        PolysynthVoice::VoiceLink link;
+        PolysynthVoice *head{nullptr}, *tail{nullptr};
+
+        void pushBack(PolysynthVoice &v);
+        void remove(PolysynthVoice &v);
+        void clear() { head = tail = nullptr; }
+    };
+    // soundingVoices and fadingVoices share linkAge; released and per key are subsets of sounding
+    VoiceList soundingVoices{PolysynthVoice::linkAge}, fadingVoices{PolysynthVoice::linkAge};
+    VoiceList releasedVoices{PolysynthVoice::linkReleased};
+    std::array<VoiceList, 128> voicesByKey;
+
+    int polyphony{0}, nSoundingVoices{0};
+    uint32_t voiceStartSerial{0};
+
+    /*
+     * The quietest heap is built from the sounding voices' envelope levels at the first
+     * quietest steal after a voice block renders, since those levels only move once a
+     * block. Popping is O(log n); an entry whose voice has since ended or restarted is
+     * recognised by its serial and skipped.
+     */
+    struct QuietEntry
+    {
+        float level;
+        uint32_t serial;
+        PolysynthVoice *voice;
+    };
+    std::array<QuietEntry, max_voices> quietHeap{};
+    int quietHeapSize{0};
+    bool quietHeapValid{false};
+
+    /*
+     * Adaptive polyphony. process times itself against the real time length of its
+     * buffer and, while that load is over pmRenderLoadLimit, ends the quietest of the
+     * released voices and holds new notes to a smaller saw unison. Shedding follows the
+     * current block's load and happens at most every shedIntervalSeconds. The cap halves
+     * at most every unisonCapDownSeconds and comes back a step at a time once the load has
+     * been well under the limit for unisonCapUpSeconds. An offline render has all the time
+     * it needs, so none of this happens there; see renderSetMode.
+     */
+  public:
+    int unisonCap{PolysynthVoice::max_uni}; // new voices read this in start
+
+    /*
+     * A voice past note off whose output peak stays under this for a few blocks ends
+     * there rather than running its release to the end inaudibly. It is
+     * pmReleaseSilenceFloor as a linear level, refreshed each process.
+     */
+    float releaseSilenceFloor{0.f};
+
+  private:
+    static constexpr double unisonCapDownSeconds{0.05}, unisonCapUpSeconds{1.0};
+    static constexpr double shedIntervalSeconds{0.05};
+    static constexpr float loadRecoveredRatio{0.7f};
+    sst::conduit::shared::RenderLoadMeter renderLoadMeter;
+    double secondsSinceUnisonCapChange{0}, secondsSinceShed{0};
+    std::atomic<bool> renderOffline{false};
+
+    bool implementsRender() const noexcept override { return true; }
+    bool renderHasHardRealtimeRequirement() noexcept override { return false; }
+    bool renderSetMode(clap_plugin_render_mode mode) noexcept override
+    {
+        renderOffline = mode == CLAP_RENDER_OFFLINE;
+        return true;
+    }
+    void adaptToRenderLoad(uint32_t frames);
+    void shedReleasedVoices();
+
+    static bool renderLoadGet(const clap_plugin_t *plugin, conduit_render_load_t *load);
+    const conduit_plugin_render_load_t renderLoadExtension{&renderLoadGet};
+    const void *extension(const char *id) noexcept override;
+
+    void makeRoomForNote(int key);
+    PolysynthVoice *chooseStealVictim(int key);
+    PolysynthVoice *quietestVoice();
+    void stealVoice(PolysynthVoice &v);
+    void voiceStopped(PolysynthVoice &v);
+    void resetVoiceLists();
+
+    ConduitPolysynthConfig::Telemetry &liveTelemetry()
+    {
+        return uiComms.dataCopyForUI.telemetry.live;
+    }
+
+    // Pair voices with matching filter setups in the 4 SIMD lanes of the filter stage
+    bool pairVoiceFilterLanes{true};
     std::vector<std::tuple<int, int, int, int>> terminatedVoices; // that's PCK ID
 };
 
@@ -458,7 +870,8 @@ struct ModMatrixConfig
         float depth;
         ConduitPolysynth::paramIds target;
     };
-    static constexpr int nModSlots{8};
+    static constexpr int nModSlots{nModMatrixSlots};
+    static_assert(nModSlots <= ModProgram::maxOps);
 
     std::array<EntryDescription, nModSlots> routings;
 
@@ -0,0 +1,153 @@
+/*
+ * Conduit - a project highlighting CLAP-first development
+ *           and exercising the surge synth team libraries.
+ *
+ * Copyright 2023-2024 Paul Walker and authors in github
+ *
+ * This file you are viewing now is released under the
+ * MIT license as described in LICENSE.md
+ *
+ * The assembled program which results from compiling this
+ * project has GPL3 dependencies, so if you distribute
+ * a binary, the combined work would be a GPL3 product.
+ *
+ * Roughly, that means you are welcome to copy the code and
+ * ideas in the src/ directory, but perhaps not code from elsewhere
+ * if you are closed source or non-GPL3. And if you do copy this code
+ * you will need to replace some of the dependencies. Please see
+ * the discussion in README.md for further information on what this may
+ * mean for you.
+ */
+
+#ifndef CONDUIT_SRC_POLYSYNTH_UNISON_SAW_BANK_H
+#define CONDUIT_SRC_POLYSYNTH_UNISON_SAW_BANK_H
+
+#include <algorithm>
+
+#include "conduit-shared/sse-include.h"
+
+namespace sst::conduit::polysynth
+{
+/*
+ * A bank of up to maxVoices detuned DPW saws, run four to an SSE register. Each saw is
+ * the differentiated square of a naive saw, the same construction as the basic-blocks
+ * DPWSawOscillator, and its phase increment glides linearly to a new frequency over a
+ * block just as the BlockInterp smoothing there does.
+ *
+ * Pan and unison level are one stereo gain per saw, so a block comes out as the 2 x n
+ * gain matrix times the n x blockSize matrix of saw samples. We accumulate that four
+ * lanes wide per sample and transpose once every four samples to finish the sums.
+ */
+template <int blockSize> struct UnisonSawBank
+{
+    static constexpr int maxVoices{16}, nQuads{maxVoices / 4};
+    static_assert(blockSize % 4 == 0);
+
+    void setVoiceCount(int n)
+    {
+        nVoices = std::clamp(n, 1, maxVoices);
+        for (int i = nVoices; i < maxVoices; ++i)
+        {
+            gainL[i] = 0.f;
+            gainR[i] = 0.f;
+        }
+    }
+    int voiceCount() const { return nVoices; }
+
+    void setGains(int i, float l, float r)
+    {
+        gainL[i] = l;
+        gainR[i] = r;
+    }
+
+    // Frequencies at or beyond nyquist are held just under it
+    void setFrequency(int i, float freqInHz, float sampleRateInv)
+    {
+        targetDPhase[i] = std::clamp(freqInHz * sampleRateInv, 0.f, 0.499f);
+    }
+
+    void retrigger()
+    {
+        for (int i = 0; i < maxVoices; ++i)
+        {
+            phase[i] = 0.f;
+            lastSaw[i] = -1.f;
+            dPhase[i] = 0.f;
+            targetDPhase[i] = 0.f;
+        }
+        glide = false;
+    }
+
+    // Writes blockSize samples of the mix of all the saws
+    void process(float *outL, float *outR)
+    {
+        const auto one = _mm_set1_ps(1.f), two = _mm_set1_ps(2.f), quarter = _mm_set1_ps(0.25f);
+        const auto minDPhase = _mm_set1_ps(1e-7f);
+        const auto invBlock = _mm_set1_ps(1.f / blockSize);
+
+        __m128 accL[blockSize], accR[blockSize];
+        for (int s = 0; s < blockSize; ++s)
+        {
+            accL[s] = _mm_setzero_ps();
+            accR[s] = _mm_setzero_ps();
+        }
+
+        auto nq = (nVoices + 3) >> 2;
+        for (int q = 0; q < nq; ++q)
+        {
+            auto ph = _mm_load_ps(phase + 4 * q);
+            auto last = _mm_load_ps(lastSaw + 4 * q);
+            auto target = _mm_load_ps(targetDPhase + 4 * q);
+            auto dp = glide ? _mm_load_ps(dPhase + 4 * q) : target;
+            auto ddp = glide ? _mm_mul_ps(_mm_sub_ps(target, dp), invBlock) : _mm_setzero_ps();
+            auto gL = _mm_load_ps(gainL + 4 * q);
+            auto gR = _mm_load_ps(gainR + 4 * q);
+
+            for (int s = 0; s < blockSize; ++s)
+            {
+                dp = _mm_add_ps(dp, ddp);
+                ph = _mm_add_ps(ph, dp);
+                ph = _mm_sub_ps(ph, _mm_and_ps(_mm_cmpge_ps(ph, one), one));
+
+                // (saw^2 - last^2) / (4 dPhase), factored so the difference doesn't cancel
+                auto saw = _mm_sub_ps(_mm_mul_ps(two, ph), one);
+                auto d2 = _mm_mul_ps(_mm_sub_ps(saw, last), _mm_add_ps(saw, last));
+                auto res = _mm_div_ps(_mm_mul_ps(d2, quarter), _mm_max_ps(dp, minDPhase));
+                last = saw;
+
+                accL[s] = _mm_add_ps(accL[s], _mm_mul_ps(gL, res));
+                accR[s] = _mm_add_ps(accR[s], _mm_mul_ps(gR, res));
+            }
+
+            _mm_store_ps(phase + 4 * q, ph);
+            _mm_store_ps(lastSaw + 4 * q, last);
+            _mm_store_ps(dPhase + 4 * q, target);
+        }
+        glide = true;
+
+        for (int s = 0; s < blockSize; s += 4)
+        {
+            _mm_storeu_ps(outL + s, sumLanes(accL + s));
+            _mm_storeu_ps(outR + s, sumLanes(accR + s));
+        }
+    }
+
+  private:
+    // lane k of the result is the sum of the four lanes of a[k]
+    static __m128 sumLanes(__m128 *a)
+    {
+        auto r0 = a[0], r1 = a[1], r2 = a[2], r3 = a[3];
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        return _mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3));
+    }
+
+    int nVoices{1};
+    // The first block after a retrigger starts at its frequency rather than gliding to it
+    bool glide{false};
+    float phase alignas(16)[maxVoices]{}, lastSaw alignas(16)[maxVoices]{};
+    float dPhase alignas(16)[maxVoices]{}, targetDPhase alignas(16)[maxVoices]{};
+    float gainL alignas(16)[maxVoices]{}, gainR alignas(16)[maxVoices]{};
+};
+} // namespace sst::conduit::polysynth
+
+#endif // CONDUIT_SRC_POLYSYNTH_UNISON_SAW_BANK_H
@@ -23,10 +23,9 @@
 #include "polysynth.h"
 #include <cmath>
 #include <algorithm>
+#include <utility>
 
-#include "libMTSClient.h"
 
-#include "sst/basic-blocks/dsp/CorrelatedNoise.h"
 #include "sst/basic-blocks/mechanics/block-ops.h"
 #include "sst/basic-blocks/dsp/FastMath.h"
 #include "sst/basic-blocks/dsp/PanLaws.h"
@@ -38,19 +37,152 @@ namespace sst::conduit::polysynth
 float pival =
     3.14159265358979323846; // I always forget what you need for M_PI to work on all platforms
 
-void PolysynthVoice::recalcPitch()
+namespace
+{
+using CP = ConduitPolysynth;
+
+// The params a voice modulates; the position in this table is the param's mod slot
+constexpr std::array<uint32_t, PolysynthVoice::nModulatableParams> voiceModParams{
+    CP::pmSawUnisonSpread,
+    CP::pmSawCoarse,
+    CP::pmSawFine,
+    CP::pmSawLevel,
+    CP::pmPWWidth,
+    CP::pmPWFrequencyDiv,
+    CP::pmPWCoarse,
+    CP::pmPWFine,
+    CP::pmPWLevel,
+    CP::pmSinFrequencyDiv,
+    CP::pmSinCoarse,
+    CP::pmSinLevel,
+    CP::pmNoiseColor,
+    CP::pmNoiseLevel,
+    CP::pmSVFCutoff,
+    CP::pmSVFResonance,
+    CP::pmSVFKeytrack,
+    CP::pmLPFCutoff,
+    CP::pmLPFResonance,
+    CP::pmLPFKeytrack,
+    CP::pmEnvA,
+    CP::pmEnvD,
+    CP::pmEnvS,
+    CP::pmEnvR,
+    CP::pmAegPreFilterGain,
+    CP::pmEnvA + CP::offPmFeg,
+    CP::pmEnvD + CP::offPmFeg,
+    CP::pmEnvS + CP::offPmFeg,
+    CP::pmEnvR + CP::offPmFeg,
+    CP::pmFegToSVFCutoff,
+    CP::pmFegToLPFCutoff,
+    CP::pmWSDrive,
+    CP::pmWSBias,
+    CP::pmFilterFeedback,
+    CP::pmVoiceLevel,
+    CP::pmVoicePan,
+    CP::pmLFORate,
+    CP::pmLFODeform,
+    CP::pmLFOAmplitude,
+    CP::pmLFORate + CP::offPmLFO2,
+    CP::pmLFODeform + CP::offPmLFO2,
+    CP::pmLFOAmplitude + CP::offPmLFO2,
+    CP::pmAegVelocitySens};
+
+constexpr int modSlotOf(uint32_t id)
+{
+    for (auto i = 0U; i < voiceModParams.size(); ++i)
+        if (voiceModParams[i] == id)
+            return (int)i;
+    return -1;
+}
+
+constexpr bool everyModParamIsInThePatch()
+{
+    for (auto id : voiceModParams)
+        if (CP::patchIndexOf(id) < 0)
+            return false;
+    return true;
+}
+static_assert(everyModParamIsInThePatch());
+
+struct ModSlotEntry
+{
+    uint32_t id;
+    int slot;
+};
+
+// voiceModParams sorted by id, so applyExternalMod can binary search a runtime id
+constexpr std::array<ModSlotEntry, PolysynthVoice::nModulatableParams> sortModSlots()
 {
-    if (mtsClient && MTS_HasMaster(mtsClient))
+    std::array<ModSlotEntry, PolysynthVoice::nModulatableParams> res{};
+    for (auto i = 0U; i < res.size(); ++i)
     {
-        baseFreq = MTS_NoteToFrequency(mtsClient, key, channel);
+        auto j = i;
+        while (j > 0 && res[j - 1].id > voiceModParams[i])
+        {
+            res[j] = res[j - 1];
+            --j;
+        }
+        res[j] = {voiceModParams[i], (int)i};
     }
-    else
+    return res;
+}
+constexpr auto modSlotsById = sortModSlots();
+} // namespace
+
+int PolysynthVoice::modSlotFor(clap_id param)
+{
+    auto it = std::lower_bound(modSlotsById.begin(), modSlotsById.end(), param,
+                               [](const auto &e, auto id) { return e.id < id; });
+    if (it == modSlotsById.end() || it->id != param)
+        return -1;
+    return it->slot;
+}
+
+template <uint32_t paramId> float PolysynthVoice::patchValue() const
+{
+    static constexpr int idx{ConduitPolysynth::patchIndexOf(paramId)};
+    static_assert(idx >= 0, "patchValue for a param which isn't in the patch");
+    return patchValues[idx];
+}
+
+namespace
+{
+// Quantize inputs into 'into' and report whether any differ from what was there
+template <size_t N> bool updateInputs(int32_t (&into)[N], const float (&from)[N], bool &valid)
+{
+    bool changed{!valid};
+    for (auto i = 0U; i < N; ++i)
     {
-        baseFreq = baseFrequencyByMidiKey[std::clamp(key, 0, 127)];
+        auto q = PolysynthVoice::quantizeInput(from[i]);
+        changed = changed || q != into[i];
+        into[i] = q;
     }
+    valid = true;
+    return changed;
+}
+} // namespace
 
+void PolysynthVoice::recalcPitch()
+{
     auto coarseBend =
         pitchNoteExpressionValue + pitchBendWheel + mpePitchBend * 24; // hardocde range for now
+
+    const float inputs[nPitchInputs] = {coarseBend,
+                                        value(sawUnisonDetune),
+                                        value(sawFine),
+                                        value(sawCoarse),
+                                        value(pulseOctave),
+                                        value(pulseCoarse),
+                                        value(pulseFine),
+                                        value(pulseWidth),
+                                        value(sinOctave),
+                                        value(sinCoarse)};
+    auto retuned = synth.tuning.generation() != pitchTuningGeneration;
+    pitchTuningGeneration = synth.tuning.generation();
+    if (!updateInputs(lastPitchInputs, inputs, pitchInputsValid) && !retuned)
+        return;
+
+    baseFreq = synth.tuning.frequency(key, channel);
     if (sawActive)
     {
         for (int i = 0; i < sawUnison; ++i)
@@ -58,10 +190,10 @@ void PolysynthVoice::recalcPitch()
             auto uf =
                 baseFreq *
                 synth.twoToXTable.twoToThe(
-                    ((sawUnisonDetune.value() * sawUniVoiceDetune[i] + sawFine.value()) / 100 +
-                     sawCoarse.value() + coarseBend) /
+                    ((value(sawUnisonDetune) * sawUniVoiceDetune[i] + value(sawFine)) / 100 +
+                     value(sawCoarse) + coarseBend) /
                     12.0);
-            sawOsc[i].setFrequency(uf, srInv);
+            sawBank.setFrequency(i, uf, srInv);
         }
     }
 
@@ -69,29 +201,34 @@ void PolysynthVoice::recalcPitch()
 
     if (pulseActive)
     {
-        auto po = std::clamp((int)std::round(pulseOctave.value()) + 3, 0, 6);
+        auto po = std::clamp((int)std::round(value(pulseOctave)) + 3, 0, 6);
         auto sbf = baseFreq * mul[po];
         auto pf = sbf * synth.twoToXTable.twoToThe(
-                            (pulseCoarse.value() + pulseFine.value() * 0.01 + coarseBend) / 12.0);
+                            (value(pulseCoarse) + value(pulseFine) * 0.01 + coarseBend) / 12.0);
         pulseOsc.setFrequency(pf, srInv);
-        pulseOsc.setPulseWidth(pulseWidth.value());
+        pulseOsc.setPulseWidth(value(pulseWidth));
     }
 
     if (sinActive)
     {
-        auto po = std::clamp((int)std::round(sinOctave.value()) + 3, 0, 6);
+        auto po = std::clamp((int)std::round(value(sinOctave)) + 3, 0, 6);
         auto sbf = baseFreq * mul[po];
-        auto pf = sbf * synth.twoToXTable.twoToThe((sinCoarse.value() + coarseBend) / 12.0);
+        auto pf = sbf * synth.twoToXTable.twoToThe((value(sinCoarse) + coarseBend) / 12.0);
         sinOsc.setRate(2.0 * M_PI * pf * srInv);
     }
 }
 
 void PolysynthVoice::recalcFilter()
 {
+    const float inputs[nFilterInputs] = {value(svfCutoff), value(svfResonance), value(lpfCutoff),
+                                         value(lpfResonance)};
+    if (!updateInputs(lastFilterInputs, inputs, filterInputsValid))
+        return;
+
     if (svfActive)
     {
-        auto co = svfCutoff.value();
-        auto rm = svfResonance.value();
+        auto co = value(svfCutoff);
+        auto rm = value(svfResonance);
         svfImpl.setCoeff(co, rm, srInv);
     }
 
@@ -99,7 +236,7 @@ void PolysynthVoice::recalcFilter()
     {
         sst::filters::FilterCoefficientMaker coefMaker;
         coefMaker.setSampleRateAndBlockSize(samplerate, blockSize);
-        coefMaker.MakeCoeffs(lpfCutoff.value() - 60, lpfResonance.value(), qfType, qfSubType,
+        coefMaker.MakeCoeffs(value(lpfCutoff) - 60, value(lpfResonance), qfType, qfSubType,
                              nullptr, false);
         coefMaker.updateState(qfState);
     }
@@ -112,38 +249,92 @@ static __m128 wsNoOp(sst::waveshapers::QuadWaveshaperState *__restrict, __m128 i
 
 static __m128 qfNoOp(sst::filters::QuadFilterUnitState *__restrict, __m128 in) { return in; }
 
-void PolysynthVoice::processBlock()
+void PolysynthVoice::processModulators()
 {
-    static constexpr float vScale{0.2};
-    aeg.processBlock(aegValues.attack.value(), aegValues.decay.value(), aegValues.sustain.value(),
-                     aegValues.release.value(), 0, 0, 0, gated);
-    feg.processBlock(fegValues.attack.value(), fegValues.decay.value(), fegValues.sustain.value(),
-                     fegValues.release.value(), 0, 0, 0, gated);
-    lfos[0].process_block(lfoData[0].rate.value(), lfoData[0].deform.value(), lfoData[0].shape);
-    lfos[1].process_block(lfoData[1].rate.value(), lfoData[1].deform.value(), lfoData[1].shape);
+    aeg.processBlock(value(aegValues.attack), value(aegValues.decay), value(aegValues.sustain),
+                     value(aegValues.release), 0, 0, 0, gated);
+    feg.processBlock(value(fegValues.attack), value(fegValues.decay), value(fegValues.sustain),
+                     value(fegValues.release), 0, 0, 0, gated);
+    lfos[0].process_block(value(lfoData[0].rate), value(lfoData[0].deform), lfoData[0].shape);
+    lfos[1].process_block(value(lfoData[1].rate), value(lfoData[1].deform), lfoData[1].shape);
+
+    modSources[msLFO1] = lfos[0].lastTarget;
+    modSources[msLFO2] = lfos[1].lastTarget;
+    modSources[msAEG] = aeg.outBlock0;
+    modSources[msFEG] = feg.outBlock0;
+    modSources[msVelocity] = velocity;
+    modSources[msReleaseVelocity] = releaseVelocity;
+    modSources[msModWheel] = midi1CC[1];
+    modSources[msPolyAT] = polyphonicAT;
+    modSources[msChannelAT] = channelPressure;
+    modSources[msMPETimbre] = mpeTimbre;
+    modSources[msMPEPressure] = mpePressure;
+    modSources[msOne] = 1.f;
+}
 
-    *svfCutoff.internalMod = 0;
-    *lpfCutoff.internalMod = 0;
+void ModProgram::evaluate(PolysynthVoice *const *vs, int n) const
+{
+    static constexpr int nSources{PolysynthVoice::nModSources};
+    static const float noVoice alignas(16)[nSources]{};
 
-    for (auto &r : routings)
-    {
-        if (r.target)
-            *(r.target) = 0;
-    }
-    for (auto &r : routings)
+    for (int v0 = 0; v0 < n; v0 += 4)
     {
-        if (r.source && r.target)
+        auto nv = std::min(4, n - v0);
+        const float *src[4];
+        for (int i = 0; i < 4; ++i)
+            src[i] = i < nv ? vs[v0 + i]->modSources : noVoice;
+
+        // lane i of sources[s] is source s of voice v0 + i
+        __m128 sources[nSources];
+        for (int s = 0; s < nSources; s += 4)
         {
-            auto s = *(r.source);
-            s *= (r.via ? *(r.via) : 1);
-            *(r.target) += s * (*r.depth) * r.range;
+            auto r0 = _mm_load_ps(src[0] + s), r1 = _mm_load_ps(src[1] + s);
+            auto r2 = _mm_load_ps(src[2] + s), r3 = _mm_load_ps(src[3] + s);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            sources[s] = r0;
+            sources[s + 1] = r1;
+            sources[s + 2] = r2;
+            sources[s + 3] = r3;
+        }
+
+        __m128 acc[maxTargets];
+        for (int t = 0; t < nTargets; ++t)
+            acc[t] = _mm_setzero_ps();
+        for (int o = 0; o < nOps; ++o)
+        {
+            const auto &op = ops[o];
+            auto m = _mm_mul_ps(sources[op.source], sources[op.via]);
+            acc[op.target] = _mm_add_ps(acc[op.target], _mm_mul_ps(m, _mm_set1_ps(op.depth)));
+        }
+
+        for (int i = 0; i < nv; ++i)
+        {
+            auto &v = *vs[v0 + i];
+            if (v.modProgramGeneration != generation)
+            {
+                std::fill(std::begin(v.internalMods), std::end(v.internalMods), 0.f);
+                v.modProgramGeneration = generation;
+            }
+        }
+        for (int t = 0; t < nTargets; ++t)
+        {
+            float lanes alignas(16)[4];
+            _mm_store_ps(lanes, acc[t]);
+            for (int i = 0; i < nv; ++i)
+                vs[v0 + i]->internalMods[targetSlots[t]] = lanes[i];
         }
     }
+}
 
-    *svfCutoff.internalMod +=
-        feg.outBlock0 * fegToSvfCutoff.value() + svfKeytrack.value() * (key - 69);
-    *lpfCutoff.internalMod +=
-        feg.outBlock0 * fegToLPFCutoff.value() + lpfKeytrack.value() * (key - 69);
+void PolysynthVoice::processBlockPreFilter()
+{
+    static constexpr float vScale{0.2};
+
+    // The mod program has already written the matrix part of these
+    internalMod(svfCutoff) +=
+        feg.outBlock0 * value(fegToSvfCutoff) + value(svfKeytrack) * (key - 69);
+    internalMod(lpfCutoff) +=
+        feg.outBlock0 * value(fegToLPFCutoff) + value(lpfKeytrack) * (key - 69);
 
     recalcFilter();
     recalcPitch();
@@ -152,28 +343,23 @@ void PolysynthVoice::processBlock()
 
     if (sawActive)
     {
-        sawLevel_lipol.newValue(sawLevel.value());
+        float saw alignas(16)[2][blockSizeOS];
+        sawBank.process(saw[0], saw[1]);
+
+        sawLevel_lipol.newValue(value(sawLevel));
         for (auto s = 0U; s < blockSizeOS; ++s)
         {
-            float L{0}, R{0};
             auto sl = sawLevel_lipol.v;
             sl = sl * sl * sl;
-            for (int i = 0; i < sawUnison; ++i)
-            {
-                auto out = sawOsc[i].step();
-                L += vScale * sl * sawUniLevelNorm[i] * sawUniPanL[i] * out;
-                R += vScale * sl * sawUniLevelNorm[i] * sawUniPanR[i] * out;
-            }
-
-            outputOS[0][s] += L;
-            outputOS[1][s] += R;
+            outputOS[0][s] += vScale * sl * saw[0][s];
+            outputOS[1][s] += vScale * sl * saw[1][s];
             sawLevel_lipol.process();
         }
     }
 
     if (pulseActive)
     {
-        pulseLevel_lipol.newValue(pulseLevel.value());
+        pulseLevel_lipol.newValue(value(pulseLevel));
         for (auto s = 0U; s < blockSizeOS; ++s)
         {
             auto sl = pulseLevel_lipol.v;
@@ -188,7 +374,7 @@ void PolysynthVoice::processBlock()
 
     if (sinActive)
     {
-        sinLevel_lipol.newValue(sinLevel.value());
+        sinLevel_lipol.newValue(value(sinLevel));
         for (auto s = 0U; s < blockSizeOS; ++s)
         {
             sinOsc.step();
@@ -204,15 +390,17 @@ void PolysynthVoice::processBlock()
 
     if (noiseActive)
     {
-        noiseLevel_lipol.newValue(noiseLevel.value());
+        float noise alignas(16)[blockSizeOS];
+        noiseRng.fillBipolar<blockSizeOS>(noise);
+        noiseFilter.process<blockSizeOS>(value(noiseColor), noise);
+
+        noiseLevel_lipol.newValue(value(noiseLevel));
         for (auto s = 0U; s < blockSizeOS; ++s)
         {
             auto sl = noiseLevel_lipol.v;
             sl = sl * sl * sl;
 
-            auto V = vScale * sl *
-                     sst::basic_blocks::dsp::correlated_noise_o2mk2_supplied_value(
-                         w0, w1, noiseColor.value(), urd(gen));
+            auto V = vScale * sl * noise[s];
             outputOS[0][s] += V;
             outputOS[1][s] += V;
 
@@ -220,108 +408,318 @@ void PolysynthVoice::processBlock()
         }
     }
 
-    // Filter stage
-    aegPFG_lipol.set_target(synth.dbToLinear(aegPFG.value()));
+    // Filter stage inputs. The filter stage itself runs either alone or paired with another
+    // voice, so all we do here is set the interpolation targets
+    aegPFG_lipol.set_target(synth.dbToLinear(value(aegPFG)));
     aegPFG_lipol.multiply_2_blocks(outputOS[0], outputOS[1]);
 
-    wsDrive_lipol.newValue(synth.dbToLinear(wsDrive.value()));
-    wsBias_lipol.newValue(wsBias.value() * (wsActive ? 1.f : 0.f));
-    filterFeedback_lipol.newValue(filterFeedback.value());
-    if (anyFilterStepActive)
-    {
-
-#define PACK                                                                                       \
-    auto output = _mm_set_ps(0, 0, outputOS[1][s], outputOS[0][s]);                                \
-    auto drive = _mm_set1_ps(wsDrive_lipol.v);                                                     \
-    wsDrive_lipol.process();                                                                       \
-    auto bias = _mm_set1_ps(wsBias_lipol.v);                                                       \
-    wsBias_lipol.process();                                                                        \
-    auto fback = _mm_set1_ps(filterFeedback_lipol.v);                                              \
-    filterFeedback_lipol.process();                                                                \
-    output = _mm_add_ps(output, filterFeedbackSignal)
-
-#define UNPACK                                                                                     \
-    filterFeedbackSignal = _mm_mul_ps(output, fback);                                              \
-    float outArr alignas(16)[4];                                                                   \
-    _mm_store_ps(outArr, output);                                                                  \
-    outputOS[0][s] = outArr[0];                                                                    \
-    outputOS[1][s] = outArr[1]
-
-        switch (filterRouting)
+    wsDrive_lipol.newValue(synth.dbToLinear(value(wsDrive)));
+    wsBias_lipol.newValue(value(wsBias) * (wsActive ? 1.f : 0.f));
+    filterFeedback_lipol.newValue(value(filterFeedback));
+}
+
+/*
+ * The filter chain is written over a 4 wide register. A voice on its own is stereo so
+ * occupies lanes 0 and 1. When two voices with the same filter configuration are playing
+ * renderVoices hands them to processBlockFiltersPaired which puts the second voice in
+ * lanes 2 and 3 and so runs the whole chain once for both voices.
+ *
+ * Pack and Unpack move a sample in and out of the register. Everything else is a template
+ * argument so the loop has no branches and the SVF step inlines; a stage which is off is
+ * simply not there.
+ */
+template <PolysynthVoice::FilterRouting R, int SVFMode, bool WS, bool LPF, typename Pack,
+          typename Unpack>
+void PolysynthVoice::filterLoop(FilterLanes &fl, Pack &&pack, Unpack &&unpack)
+{
+    const auto half = _mm_set1_ps(0.5f);
+
+    auto svf = [&](__m128 in) {
+        if constexpr (SVFMode == svfBypass)
+            return in;
+        else
+            return StereoSimperSVF::stepSSE<SVFMode>(fl.svf, in);
+    };
+    auto qf = [&](__m128 in) {
+        if constexpr (LPF)
+            return fl.qf(fl.qfs, in);
+        else
+            return in;
+    };
+    auto ws = [&](__m128 in, __m128 bias, __m128 drive) {
+        if constexpr (WS)
+            return fl.ws(fl.wss, _mm_add_ps(in, bias), drive);
+        else
+            return in;
+    };
+
+    for (auto s = 0U; s < blockSizeOS; ++s)
+    {
+        __m128 drive, bias, fback;
+        auto output = _mm_add_ps(pack(s, drive, bias, fback), fl.feedback);
+
+        if constexpr (R == LowWSMulti)
         {
-        case LowWSMulti:
-            for (auto s = 0U; s < blockSizeOS; ++s)
-            {
-                PACK;
-                output = qfPtr(&qfState, output);
-                output = wsPtr(&wsState, _mm_add_ps(output, bias), drive);
-                output = svfFilterOp(svfImpl, output);
-                UNPACK;
-            }
-            break;
-        case MultiWSLow:
-            for (auto s = 0U; s < blockSizeOS; ++s)
-            {
-                PACK;
-                output = svfFilterOp(svfImpl, output);
-                output = wsPtr(&wsState, _mm_add_ps(output, bias), drive);
-                output = qfPtr(&qfState, output);
-                UNPACK;
-            }
-            break;
-        case WSLowMulti:
-            for (auto s = 0U; s < blockSizeOS; ++s)
-            {
-                PACK;
-                output = wsPtr(&wsState, _mm_add_ps(output, bias), drive);
-                output = qfPtr(&qfState, output);
-                output = svfFilterOp(svfImpl, output);
-                UNPACK;
-            }
-            break;
-        case LowMultiWS:
-            for (auto s = 0U; s < blockSizeOS; ++s)
-            {
-                PACK;
-                output = qfPtr(&qfState, output);
-                output = svfFilterOp(svfImpl, output);
-                output = wsPtr(&wsState, _mm_add_ps(output, bias), drive);
-                UNPACK;
-            }
-            break;
-        case WSPar:
-            for (auto s = 0U; s < blockSizeOS; ++s)
-            {
-                PACK;
-                output = wsPtr(&wsState, _mm_add_ps(output, bias), drive);
-
-                auto outputQ = qfPtr(&qfState, output);
-                auto outputS = svfFilterOp(svfImpl, output);
-                const auto half = _mm_set1_ps(0.5f);
-                output = _mm_mul_ps(half, _mm_add_ps(outputQ, outputS));
-                UNPACK;
-            }
-            break;
-        case ParWS:
-            for (auto s = 0U; s < blockSizeOS; ++s)
+            output = svf(ws(qf(output), bias, drive));
+        }
+        else if constexpr (R == MultiWSLow)
+        {
+            output = qf(ws(svf(output), bias, drive));
+        }
+        else if constexpr (R == WSLowMulti)
+        {
+            output = svf(qf(ws(output, bias, drive)));
+        }
+        else if constexpr (R == LowMultiWS)
+        {
+            output = ws(svf(qf(output)), bias, drive);
+        }
+        else if constexpr (R == WSPar)
+        {
+            output = ws(output, bias, drive);
+            output = _mm_mul_ps(half, _mm_add_ps(qf(output), svf(output)));
+        }
+        else if constexpr (R == ParWS)
+        {
+            output = _mm_mul_ps(half, _mm_add_ps(qf(output), svf(output)));
+            output = ws(output, bias, drive);
+        }
+
+        fl.feedback = _mm_mul_ps(output, fback);
+        unpack(s, output);
+    }
+}
+
+template <PolysynthVoice::FilterRouting R, int SVFMode, bool WS, bool LPF>
+void PolysynthVoice::filterKernel(PolysynthVoice &v)
+{
+    FilterLanes fl{v.svfImpl, &v.qfState, v.qfPtr, &v.wsState, v.wsPtr, v.filterFeedbackSignal};
+    filterLoop<R, SVFMode, WS, LPF>(
+        fl,
+        [&v](auto s, auto &drive, auto &bias, auto &fback) {
+            drive = _mm_set1_ps(v.wsDrive_lipol.v);
+            v.wsDrive_lipol.process();
+            bias = _mm_set1_ps(v.wsBias_lipol.v);
+            v.wsBias_lipol.process();
+            fback = _mm_set1_ps(v.filterFeedback_lipol.v);
+            v.filterFeedback_lipol.process();
+            return _mm_set_ps(0, 0, v.outputOS[1][s], v.outputOS[0][s]);
+        },
+        [&v](auto s, auto output) {
+            float outArr alignas(16)[4];
+            _mm_store_ps(outArr, output);
+            v.outputOS[0][s] = outArr[0];
+            v.outputOS[1][s] = outArr[1];
+        });
+}
+
+template <PolysynthVoice::FilterRouting R, int SVFMode, bool WS, bool LPF>
+void PolysynthVoice::pairedFilterKernel(PolysynthVoice &a, PolysynthVoice &b)
+{
+    PairedFilterState ps;
+    ps.gather(a, b);
+
+    FilterLanes fl{ps.svf, &ps.qfs, a.qfPtr, &ps.wss, a.wsPtr, ps.feedback};
+    filterLoop<R, SVFMode, WS, LPF>(
+        fl,
+        [&a, &b](auto s, auto &drive, auto &bias, auto &fback) {
+            drive = _mm_set_ps(b.wsDrive_lipol.v, b.wsDrive_lipol.v, a.wsDrive_lipol.v,
+                               a.wsDrive_lipol.v);
+            bias = _mm_set_ps(b.wsBias_lipol.v, b.wsBias_lipol.v, a.wsBias_lipol.v,
+                              a.wsBias_lipol.v);
+            fback = _mm_set_ps(b.filterFeedback_lipol.v, b.filterFeedback_lipol.v,
+                               a.filterFeedback_lipol.v, a.filterFeedback_lipol.v);
+            for (auto *v : {&a, &b})
             {
-                PACK;
-                auto outputQ = qfPtr(&qfState, output);
-                auto outputS = svfFilterOp(svfImpl, output);
-                const auto half = _mm_set1_ps(0.5f);
-                output = _mm_mul_ps(half, _mm_add_ps(outputQ, outputS));
-                output = wsPtr(&wsState, _mm_add_ps(output, bias), drive);
-
-                UNPACK;
+                v->wsDrive_lipol.process();
+                v->wsBias_lipol.process();
+                v->filterFeedback_lipol.process();
             }
-            break;
+            return _mm_set_ps(b.outputOS[1][s], b.outputOS[0][s], a.outputOS[1][s],
+                              a.outputOS[0][s]);
+        },
+        [&a, &b](auto s, auto output) {
+            float outArr alignas(16)[4];
+            _mm_store_ps(outArr, output);
+            a.outputOS[0][s] = outArr[0];
+            a.outputOS[1][s] = outArr[1];
+            b.outputOS[0][s] = outArr[2];
+            b.outputOS[1][s] = outArr[3];
+        });
+
+    ps.scatter(a, b);
+}
+
+namespace
+{
+using PV = PolysynthVoice;
+
+// The table is indexed by routing, then SVF mode (or bypass), then waveshaper on, then LPF on
+static constexpr size_t nFilterRoutings{PV::ParWS + 1}, nSVFModes{PV::svfBypass + 1};
+static constexpr size_t nFilterKernels{nFilterRoutings * nSVFModes * 4};
+
+constexpr size_t filterKernelIndex(size_t routing, size_t svfMode, bool ws, bool lpf)
+{
+    return ((routing * nSVFModes + svfMode) * 2 + (ws ? 1 : 0)) * 2 + (lpf ? 1 : 0);
+}
+
+template <size_t I> struct FilterKernelAt
+{
+    static constexpr auto routing = (PV::FilterRouting)(I / (nSVFModes * 4));
+    static constexpr int svfMode = (int)(I / 4 % nSVFModes);
+    static constexpr bool ws = I / 2 % 2, lpf = I % 2;
+};
+
+template <size_t... I> constexpr auto makeFilterKernels(std::index_sequence<I...>)
+{
+    return std::array<void (*)(PV &), sizeof...(I)>{
+        {&PV::filterKernel<FilterKernelAt<I>::routing, FilterKernelAt<I>::svfMode,
+                           FilterKernelAt<I>::ws, FilterKernelAt<I>::lpf>...}};
+}
+
+template <size_t... I> constexpr auto makePairedFilterKernels(std::index_sequence<I...>)
+{
+    return std::array<void (*)(PV &, PV &), sizeof...(I)>{
+        {&PV::pairedFilterKernel<FilterKernelAt<I>::routing, FilterKernelAt<I>::svfMode,
+                                 FilterKernelAt<I>::ws, FilterKernelAt<I>::lpf>...}};
+}
+
+static constexpr auto filterKernels = makeFilterKernels(std::make_index_sequence<nFilterKernels>());
+static constexpr auto pairedFilterKernels =
+    makePairedFilterKernels(std::make_index_sequence<nFilterKernels>());
+} // namespace
+
+void PolysynthVoice::selectFilterKernel()
+{
+    auto routing = std::clamp((int)filterRouting, 0, (int)nFilterRoutings - 1);
+    auto mode = svfActive ? std::clamp(svfMode, 0, (int)StereoSimperSVF::ALL) : svfBypass;
+    auto idx = filterKernelIndex(routing, mode, wsActive, lpfActive);
+    filterKernelFn = filterKernels[idx];
+    pairedFilterKernelFn = pairedFilterKernels[idx];
+}
+
+void PolysynthVoice::processBlockFilters()
+{
+    if (!anyFilterStepActive)
+        return;
+
+    filterKernelFn(*this);
+}
+
+bool PolysynthVoice::canShareFilterLanesWith(const PolysynthVoice &other) const
+{
+    if (!anyFilterStepActive || !other.anyFilterStepActive)
+        return false;
+
+    // The kernel already pins down the routing, the SVF mode and which stages are on
+    return filterKernelFn == other.filterKernelFn && qfPtr == other.qfPtr &&
+           wsPtr == other.wsPtr;
+}
+
+namespace
+{
+// a0 a1 b0 b1
+inline __m128 joinLanes(__m128 a, __m128 b) { return _mm_movelh_ps(a, b); }
+// p2 p3 p2 p3
+inline __m128 upperLanes(__m128 p) { return _mm_movehl_ps(p, p); }
+
+template <size_t N> void joinLanes(__m128 (&to)[N], const __m128 (&a)[N], const __m128 (&b)[N])
+{
+    for (auto i = 0U; i < N; ++i)
+        to[i] = joinLanes(a[i], b[i]);
+}
+
+template <size_t N> void splitLanes(const __m128 (&from)[N], __m128 (&a)[N], __m128 (&b)[N])
+{
+    for (auto i = 0U; i < N; ++i)
+    {
+        a[i] = from[i];
+        b[i] = upperLanes(from[i]);
+    }
+}
+} // namespace
+
+// Gather b's lanes 0/1 state into lanes 2/3 of a working copy of a's state
+void PolysynthVoice::PairedFilterState::gather(const PolysynthVoice &a, const PolysynthVoice &b)
+{
+    svf.ic1eq = joinLanes(a.svfImpl.ic1eq, b.svfImpl.ic1eq);
+    svf.ic2eq = joinLanes(a.svfImpl.ic2eq, b.svfImpl.ic2eq);
+    svf.g = joinLanes(a.svfImpl.g, b.svfImpl.g);
+    svf.k = joinLanes(a.svfImpl.k, b.svfImpl.k);
+    svf.gk = joinLanes(a.svfImpl.gk, b.svfImpl.gk);
+    svf.a1 = joinLanes(a.svfImpl.a1, b.svfImpl.a1);
+    svf.a2 = joinLanes(a.svfImpl.a2, b.svfImpl.a2);
+    svf.a3 = joinLanes(a.svfImpl.a3, b.svfImpl.a3);
+    svf.ak = joinLanes(a.svfImpl.ak, b.svfImpl.ak);
+
+    qfs = a.qfState;
+    if (a.lpfActive)
+    {
+        joinLanes(qfs.C, a.qfState.C, b.qfState.C);
+        joinLanes(qfs.dC, a.qfState.dC, b.qfState.dC);
+        joinLanes(qfs.R, a.qfState.R, b.qfState.R);
+        for (int i = 0; i < 2; ++i)
+        {
+            qfs.DB[i + 2] = b.qfState.DB[i];
+            qfs.WP[i + 2] = b.qfState.WP[i];
+            qfs.active[i + 2] = b.qfState.active[i];
         }
     }
+
+    wss = a.wsState;
+    if (a.wsActive)
+    {
+        joinLanes(wss.R, a.wsState.R, b.wsState.R);
+        wss.init = joinLanes(a.wsState.init, b.wsState.init);
+    }
+
+    feedback = joinLanes(a.filterFeedbackSignal, b.filterFeedbackSignal);
+}
+
+// And scatter back. Lanes 2/3 of each voice's own state are unused when it runs alone
+void PolysynthVoice::PairedFilterState::scatter(PolysynthVoice &a, PolysynthVoice &b) const
+{
+    a.svfImpl.ic1eq = svf.ic1eq;
+    a.svfImpl.ic2eq = svf.ic2eq;
+    b.svfImpl.ic1eq = upperLanes(svf.ic1eq);
+    b.svfImpl.ic2eq = upperLanes(svf.ic2eq);
+
+    if (a.lpfActive)
+    {
+        splitLanes(qfs.C, a.qfState.C, b.qfState.C);
+        splitLanes(qfs.dC, a.qfState.dC, b.qfState.dC);
+        splitLanes(qfs.R, a.qfState.R, b.qfState.R);
+        for (int i = 0; i < 2; ++i)
+        {
+            a.qfState.WP[i] = qfs.WP[i];
+            b.qfState.WP[i] = qfs.WP[i + 2];
+        }
+    }
+
+    if (a.wsActive)
+    {
+        splitLanes(wss.R, a.wsState.R, b.wsState.R);
+        a.wsState.init = wss.init;
+        b.wsState.init = upperLanes(wss.init);
+    }
+
+    a.filterFeedbackSignal = feedback;
+    b.filterFeedbackSignal = upperLanes(feedback);
+}
+
+void PolysynthVoice::processBlockFiltersPaired(PolysynthVoice &a, PolysynthVoice &b)
+{
+    assert(a.canShareFilterLanesWith(b));
+    a.pairedFilterKernelFn(a, b);
+}
+
+void PolysynthVoice::processBlockPostFilter()
+{
     sst::basic_blocks::mechanics::scale_by<blockSizeOS>(aeg.outputCache, outputOS[0]);
     sst::basic_blocks::mechanics::scale_by<blockSizeOS>(aeg.outputCache, outputOS[1]);
 
-    auto olv = outputLevel.value();
-    auto velSen = velocitySens.value();
+    auto olv = value(outputLevel);
+    auto velSen = value(velocitySens);
     auto velAtten = velocity * velSen + (1 - velSen);
     olv *= velAtten;
 
@@ -330,7 +728,7 @@ void PolysynthVoice::processBlock()
     outputLevel_lipol.set_target(olv);
     outputLevel_lipol.multiply_2_blocks(outputOS[0], outputOS[1]);
 
-    auto opv = outputPan.value();
+    auto opv = value(outputPan);
     if (opv != 0.f)
     {
         sst::basic_blocks::dsp::pan_laws::panmatrix_t panMatrix;
@@ -344,6 +742,37 @@ void PolysynthVoice::processBlock()
             outputOS[1][s] = r;
         }
     }
+
+    if (stolen)
+    {
+        for (auto s = 0U; s < blockSizeOS; ++s)
+        {
+            outputOS[0][s] *= stealGain;
+            outputOS[1][s] *= stealGain;
+            stealGain = std::max(0.f, stealGain - stealGainStep);
+        }
+    }
+    else if (!gated)
+    {
+        if (outputPeak() < synth.releaseSilenceFloor)
+            silenced = ++silentBlocks >= silentBlocksToEnd;
+        else
+            silentBlocks = 0;
+    }
+}
+
+float PolysynthVoice::outputPeak() const
+{
+    const auto absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    auto peak = _mm_setzero_ps();
+    for (auto c = 0; c < 2; ++c)
+    {
+        for (auto s = 0U; s < blockSizeOS; s += 4)
+            peak = _mm_max_ps(peak, _mm_and_ps(_mm_load_ps(outputOS[c] + s), absMask));
+    }
+    peak = _mm_max_ps(peak, _mm_movehl_ps(peak, peak));
+    peak = _mm_max_ss(peak, _mm_shuffle_ps(peak, peak, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(peak);
 }
 
 void PolysynthVoice::start(int16_t porti, int16_t channeli, int16_t keyi, int32_t noteidi,
@@ -359,58 +788,38 @@ void PolysynthVoice::start(int16_t porti, int16_t channeli, int16_t keyi, int32_
     mpePitchBend = 0;
     filterFeedbackSignal = _mm_setzero_ps();
 
-    sawUnison = static_cast<int>(*synth.paramToValue.at(ConduitPolysynth::pmSawUnisonCount));
+    sawUnison = static_cast<int>(patchValue<ConduitPolysynth::pmSawUnisonCount>());
+    sawUnison = std::clamp(sawUnison, 1, std::max(1, synth.unisonCap));
 
-    sawActive = static_cast<bool>(*synth.paramToValue.at(ConduitPolysynth::pmSawActive));
-    pulseActive = static_cast<bool>(*synth.paramToValue.at(ConduitPolysynth::pmPWActive));
-    sinActive = static_cast<bool>(*synth.paramToValue.at(ConduitPolysynth::pmSinActive));
-    noiseActive = static_cast<bool>(*synth.paramToValue.at(ConduitPolysynth::pmNoiseActive));
+    sawActive = static_cast<bool>(patchValue<ConduitPolysynth::pmSawActive>());
+    pulseActive = static_cast<bool>(patchValue<ConduitPolysynth::pmPWActive>());
+    sinActive = static_cast<bool>(patchValue<ConduitPolysynth::pmSinActive>());
+    noiseActive = static_cast<bool>(patchValue<ConduitPolysynth::pmNoiseActive>());
 
-    svfActive = static_cast<bool>(*synth.paramToValue.at(ConduitPolysynth::pmSVFActive));
+    svfActive = static_cast<bool>(patchValue<ConduitPolysynth::pmSVFActive>());
     if (svfActive)
     {
-        svfMode = static_cast<int>(*synth.paramToValue.at(ConduitPolysynth::pmSVFFilterMode));
-        switch (svfMode)
-        {
-        case StereoSimperSVF::LP:
-            svfFilterOp = StereoSimperSVF::stepSSE<StereoSimperSVF::LP>;
-            break;
-        case StereoSimperSVF::HP:
-            svfFilterOp = StereoSimperSVF::stepSSE<StereoSimperSVF::HP>;
-            break;
-        case StereoSimperSVF::BP:
-            svfFilterOp = StereoSimperSVF::stepSSE<StereoSimperSVF::BP>;
-            break;
-        case StereoSimperSVF::NOTCH:
-            svfFilterOp = StereoSimperSVF::stepSSE<StereoSimperSVF::NOTCH>;
-            break;
-        case StereoSimperSVF::PEAK:
-            svfFilterOp = StereoSimperSVF::stepSSE<StereoSimperSVF::PEAK>;
-            break;
-        case StereoSimperSVF::ALL:
-            svfFilterOp = StereoSimperSVF::stepSSE<StereoSimperSVF::ALL>;
-            break;
-        }
-    }
-    else
-    {
-        svfFilterOp = [](auto &a, auto b) { return b; };
+        svfMode = static_cast<int>(patchValue<ConduitPolysynth::pmSVFFilterMode>());
     }
 
     gated = true;
     active = true;
+    stolen = false;
+    stealGain = 1.f;
+    silentBlocks = 0;
+    silenced = false;
     srInv = 1.0 / samplerate;
 
     svfImpl.init();
 
-    aeg.attackFrom(0.f, aegValues.attack.value(), 0, false);
-    feg.attackFrom(0.f, fegValues.attack.value(), 0, false);
+    aeg.attackFrom(0.f, value(aegValues.attack), 0, false);
+    feg.attackFrom(0.f, value(fegValues.attack), 0, false);
+    sawBank.retrigger();
+    sawBank.setVoiceCount(sawUnison);
     if (sawUnison == 1)
     {
         sawUniVoiceDetune[0] = 0;
-        sawUniPanL[0] = 1;
-        sawUniPanR[0] = 1;
-        sawUniLevelNorm[0] = 1.0;
+        sawBank.setGains(0, 1, 1);
     }
     else
     {
@@ -418,26 +827,19 @@ void PolysynthVoice::start(int16_t porti, int16_t channeli, int16_t keyi, int32_
         {
             float dI = 1.0 * i / (sawUnison - 1);
             sawUniVoiceDetune[i] = 2 * dI - 1;
-            sawUniPanL[i] = std::cos(0.5 * pival * dI);
-            sawUniPanR[i] = std::sin(0.5 * pival * dI);
 
-            sawUniLevelNorm[i] = 1.0 / sqrt(sawUnison);
+            float levelNorm = 1.0 / sqrt(sawUnison);
+            sawBank.setGains(i, levelNorm * std::cos(0.5 * pival * dI),
+                             levelNorm * std::sin(0.5 * pival * dI));
         }
     }
 
-    for (auto &o : sawOsc)
-        o.retrigger();
-
-    recalcPitch();
-    recalcFilter();
-
-    wsActive = static_cast<bool>(*synth.paramToValue.at(ConduitPolysynth::pmWSActive));
+    wsActive = static_cast<bool>(patchValue<ConduitPolysynth::pmWSActive>());
 
     if (wsActive)
     {
         float R[sst::waveshapers::n_waveshaper_registers];
-        auto wsTypeEnum =
-            static_cast<Waveshapers>(*synth.paramToValue.at(ConduitPolysynth::pmWSMode));
+        auto wsTypeEnum = static_cast<Waveshapers>(patchValue<ConduitPolysynth::pmWSMode>());
 
         auto type = sst::waveshapers::WaveshaperType::wst_ojd;
         switch (wsTypeEnum)
@@ -475,21 +877,21 @@ void PolysynthVoice::start(int16_t porti, int16_t channeli, int16_t keyi, int32_
         wsPtr = wsNoOp;
     }
 
-    lpfActive = static_cast<bool>(*synth.paramToValue.at(ConduitPolysynth::pmLPFActive));
+    lpfActive = static_cast<bool>(patchValue<ConduitPolysynth::pmLPFActive>());
 
     if (lpfActive)
     {
         qfState = sst::filters::QuadFilterUnitState{};
         for (int i = 0; i < 4; ++i)
         {
-            memset(delayBufferData[i], 0, sizeof(delayBufferData[i]));
-            qfState.DB[i] = delayBufferData[i];
-            qfState.active[i] = (int)0xffffffff;
+            // Lanes 2 and 3 only carry signal when a partner voice is paired into them,
+            // and then they are its lanes 0 and 1
+            qfState.DB[i] = nullptr;
+            qfState.active[i] = i < 2 ? (int)0xffffffff : 0;
             qfState.WP[i] = 0;
         }
 
-        auto lpfTypeEnum =
-            static_cast<LPFTypes>(*synth.paramToValue.at(ConduitPolysynth::pmLPFFilterMode));
+        auto lpfTypeEnum = static_cast<LPFTypes>(patchValue<ConduitPolysynth::pmLPFFilterMode>());
 
         switch (lpfTypeEnum)
         {
@@ -519,6 +921,24 @@ void PolysynthVoice::start(int16_t porti, int16_t channeli, int16_t keyi, int32_
             break;
         }
 
+        if (lpfTypeEnum == Comb)
+        {
+            auto lines = synth.combDelayLinesFor(*this);
+            if (lines)
+            {
+                memset(lines, 0, 2 * ConduitPolysynth::combLineSize * sizeof(float));
+                qfState.DB[0] = lines;
+                qfState.DB[1] = lines + ConduitPolysynth::combLineSize;
+            }
+            else
+            {
+                lpfActive = false;
+            }
+        }
+    }
+
+    if (lpfActive)
+    {
         qfPtr = sst::filters::GetCompensatedQFPtrFilterUnit<true>(qfType, qfSubType);
     }
     else
@@ -526,98 +946,28 @@ void PolysynthVoice::start(int16_t porti, int16_t channeli, int16_t keyi, int32_
         qfPtr = qfNoOp;
     }
 
-    filterRouting =
-        static_cast<FilterRouting>(*synth.paramToValue.at(ConduitPolysynth::pmFilterRouting));
+    filterRouting = static_cast<FilterRouting>(patchValue<ConduitPolysynth::pmFilterRouting>());
 
     anyFilterStepActive = wsActive || svfActive || lpfActive;
+    selectFilterKernel();
+
+    // After the filter setup, since that resets qfState and the LPF coefficients with it
+    invalidateCoefficientCaches();
+    recalcPitch();
+    recalcFilter();
 
-    auto l1shp = static_cast<int>(*synth.paramToValue.at(ConduitPolysynth::pmLFOShape));
+    auto l1shp = static_cast<int>(patchValue<ConduitPolysynth::pmLFOShape>());
     if (l1shp > 1)
         l1shp++;
     lfoData[0].shape = (lfo_t::Shape)l1shp;
     lfos[0].attack(lfoData[0].shape);
 
     auto l2shp = static_cast<int>(
-        *synth.paramToValue.at(ConduitPolysynth::pmLFOShape + ConduitPolysynth::offPmLFO2));
+        patchValue<ConduitPolysynth::pmLFOShape + ConduitPolysynth::offPmLFO2>());
     if (l2shp > 1)
         l2shp++;
     lfoData[1].shape = (lfo_t::Shape)l2shp;
     lfos[1].attack(lfoData[1].shape);
-
-    // This obviously can be built at start time more intelligently
-    int idx{0};
-    for (auto &r : synth.patch.extension.modMatrixConfig->routings)
-    {
-        if (idx >= routings.size())
-        {
-            assert(false);
-            continue;
-        }
-        routings[idx] = {};
-        auto &rt = routings[idx];
-
-        if (r.source != ModMatrixConfig::NONE && r.target != ConduitPolysynth::pmNoModTarget)
-        {
-            auto pmd = synth.paramDescriptionMap.at(r.target);
-            rt.range = pmd.maxVal - pmd.minVal;
-            auto tp = internalMods.find(r.target);
-
-            auto assignMod = [this](const auto &basedOn, auto &to) {
-                switch (basedOn)
-                {
-                case ModMatrixConfig::LFO1:
-                    to = &(lfos[0].lastTarget);
-                    break;
-
-                case ModMatrixConfig::LFO2:
-                    to = &(lfos[1].lastTarget);
-                    break;
-
-                case ModMatrixConfig::AEG:
-                    to = &(aeg.outBlock0);
-                    break;
-
-                case ModMatrixConfig::FEG:
-                    to = &(feg.outBlock0);
-                    break;
-
-                case ModMatrixConfig::PolyAT:
-                    to = &polyphonicAT;
-                    break;
-
-                case ModMatrixConfig::ChannelAT:
-                    to = &channelPressure;
-                    break;
-
-                case ModMatrixConfig::ModWheel:
-                    to = &midi1CC[1];
-                    break;
-
-                case ModMatrixConfig::ReleaseVelocity:
-                    to = &releaseVelocity;
-                    break;
-
-                case ModMatrixConfig::MPETimbre:
-                    to = &mpeTimbre;
-                    break;
-
-                case ModMatrixConfig::MPEPressure:
-                    to = &mpePressure;
-                    break;
-
-                default:
-                    break;
-                }
-            };
-            rt.source = nullptr;
-            rt.via = nullptr;
-            assignMod(r.source, rt.source);
-            assignMod(r.via, rt.via);
-            rt.target = &(tp->second);
-            rt.depth = &(r.depth);
-        }
-        idx++;
-    }
 }
 
 void PolysynthVoice::release() { gated = false; }
@@ -703,12 +1053,13 @@ void PolysynthVoice::StereoSimperSVF::init()
 
 void PolysynthVoice::attachTo(sst::conduit::polysynth::ConduitPolysynth &p)
 {
-    auto attach = [this, &p](clap_id parm, ModulatedValue &toThat) {
-        p.attachParam(parm, toThat.base);
-        externalMods[parm] = 0;
-        internalMods[parm] = 0;
-        toThat.internalMod = &(internalMods[parm]);
-        toThat.externalMod = &(externalMods[parm]);
+    patchValues = p.patch.params;
+    auto attach = [this](clap_id parm, ModulatedValue &toThat) {
+        toThat.patchIndex = ConduitPolysynth::patchIndexOf(parm);
+        toThat.slot = modSlotOf(parm);
+        assert(toThat.patchIndex >= 0 && toThat.slot >= 0);
+        externalMods[toThat.slot] = 0;
+        internalMods[toThat.slot] = 0;
     };
     attach(ConduitPolysynth::pmSawUnisonSpread, sawUnisonDetune);
     attach(ConduitPolysynth::pmSawCoarse, sawCoarse);
@@ -768,16 +1119,14 @@ void PolysynthVoice::attachTo(sst::conduit::polysynth::ConduitPolysynth &p)
     attach(ConduitPolysynth::pmLFOAmplitude + ConduitPolysynth::offPmLFO2, lfoData[1].amplitude);
 
     attach(ConduitPolysynth::pmAegVelocitySens, velocitySens);
-
-    mtsClient = p.mtsClient;
 }
 
 void PolysynthVoice::applyExternalMod(clap_id param, float value)
 {
-    auto emit = externalMods.find(param);
-    if (emit != externalMods.end())
+    auto slot = modSlotFor(param);
+    if (slot >= 0)
     {
-        emit->second = value;
+        externalMods[slot] = value;
     }
 }
 
@@ -22,13 +22,13 @@
 #ifndef CONDUIT_SRC_POLYSYNTH_VOICE_H
 #define CONDUIT_SRC_POLYSYNTH_VOICE_H
 
+#include <algorithm>
 #include <array>
-#include <random>
-#include <unordered_map>
-#include <functional>
+#include <cmath>
 
 #include <clap/clap.h>
 
+#include "conduit-shared/block-noise.h"
 #include "conduit-shared/debug-helpers.h"
 #include "conduit-shared/sse-include.h"
 
@@ -41,34 +41,32 @@
 #include "sst/filters.h"
 #include "sst/waveshapers.h"
 
-struct MTSClient;
+#include "unison-saw-bank.h"
 
 namespace sst::conduit::polysynth
 {
 
 struct ConduitPolysynth;
 
-struct PolysynthVoice
+struct alignas(64) PolysynthVoice
 {
-    static constexpr int max_uni{7};
     static constexpr int blockSize{8};
     static constexpr int blockSizeOS{blockSize << 1};
+    static constexpr int max_uni{UnisonSawBank<blockSizeOS>::maxVoices};
 
     const ConduitPolysynth &synth;
     PolysynthVoice(const ConduitPolysynth &sy)
-        : synth(sy), gen((uint64_t)(this)), urd(-1.0, 1.0), aeg(this), feg(this), lfos{this, this}
+        : synth(sy), aeg(this), feg(this), lfos{this, this}
     {
-        for (int i = 0; i < 128; ++i)
-        {
-            baseFrequencyByMidiKey[i] = 440.0 * pow(2.0, (i - 69.0) / 12.0);
-        }
     }
 
     void setSampleRate(double sr)
     {
         samplerate = sr;
+        silentBlocksToEnd = std::max(1, (int)std::ceil(silenceHoldSeconds * sr / blockSizeOS));
         aeg.onSampleRateChanged();
         feg.onSampleRateChanged();
+        invalidateCoefficientCaches();
     }
 
     int portid;  // clap note port index
@@ -83,23 +81,59 @@ struct PolysynthVoice
     float channelPressure{0.f}; // scaled 0..1
     float midi1CC[128]{};       // scaled 0...1
 
-    MTSClient *mtsClient{nullptr};
     void attachTo(ConduitPolysynth &p);
 
+    /*
+     * Every parameter a voice modulates owns a slot in the flat mod arrays below. The
+     * slots are fixed at compile time by the table in voice.cpp so a ModulatedValue is
+     * just a pair of indices and reading one never hashes.
+     */
+    static constexpr int nModulatableParams{43};
+
     struct ModulatedValue
     {
-        float *base{nullptr};
-        float *externalMod{nullptr};
-        float *internalMod{nullptr};
+        int16_t patchIndex{-1};
+        int16_t slot{-1};
+    };
 
-        inline float value()
-        {
-            assert(base);
-            assert(internalMod);
-            assert(externalMod);
-            return *base + *externalMod + *internalMod;
-        }
+    const float *patchValues{nullptr};
+    float externalMods[nModulatableParams]{}, internalMods[nModulatableParams]{};
+
+    inline float value(const ModulatedValue &mv) const
+    {
+        assert(mv.patchIndex >= 0 && mv.slot >= 0);
+        return patchValues[mv.patchIndex] + externalMods[mv.slot] + internalMods[mv.slot];
+    }
+    inline float &internalMod(const ModulatedValue &mv) { return internalMods[mv.slot]; }
+
+    // The mod slot for a param id, or -1 if voices don't modulate it
+    static int modSlotFor(clap_id param);
+
+    /*
+     * The mod matrix reads its sources from modSources, which processModulators fills at
+     * the top of each block, and writes its targets into internalMods; see ModProgram.
+     * msOne is a constant 1 so a routing without a via needs no special case.
+     */
+    enum ModSourceIndex : uint8_t
+    {
+        msLFO1,
+        msLFO2,
+        msAEG,
+        msFEG,
+        msVelocity,
+        msReleaseVelocity,
+        msModWheel,
+        msPolyAT,
+        msChannelAT,
+        msMPETimbre,
+        msMPEPressure,
+        msOne,
+        nModSources
     };
+    static_assert(nModSources % 4 == 0, "ModProgram reads sources four at a time");
+    float modSources alignas(16)[nModSources]{};
+    uint32_t modProgramGeneration{0};
+    template <uint32_t paramId> float patchValue() const;
 
     // If you change this also change the param in polysynth.cpp
     enum FilterRouting
@@ -132,8 +166,6 @@ struct PolysynthVoice
         Comb
     };
 
-    std::unordered_map<clap_id, float> externalMods, internalMods;
-
     void applyExternalMod(clap_id param, float value);
 
     // Saw Oscillator
@@ -141,11 +173,8 @@ struct PolysynthVoice
     bool sawActive{true};
     ModulatedValue sawUnisonDetune, sawCoarse, sawFine, sawLevel;
     sst::basic_blocks::dsp::lipol<float, blockSizeOS, true> sawLevel_lipol;
-    std::array<float, max_uni> sawUniPanL, sawUniPanR, sawUniVoiceDetune, sawUniLevelNorm;
-    std::array<sst::basic_blocks::dsp::DPWSawOscillator<
-                   sst::basic_blocks::dsp::BlockInterpSmoothingStrategy<blockSize>>,
-               max_uni>
-        sawOsc;
+    std::array<float, max_uni> sawUniVoiceDetune;
+    UnisonSawBank<blockSizeOS> sawBank;
 
     // Pulse Oscillator
     bool pulseActive{true};
@@ -165,9 +194,9 @@ struct PolysynthVoice
     bool noiseActive{true};
     ModulatedValue noiseColor, noiseLevel;
     sst::basic_blocks::dsp::lipol<float, blockSizeOS, true> noiseLevel_lipol;
-    float w0, w1;
-    std::default_random_engine gen;
-    std::uniform_real_distribution<float> urd;
+    // seeded from the synth's seed and our pool index; see ConduitPolysynth::setRandomSeed
+    sst::conduit::shared::BlockRNG noiseRng;
+    sst::conduit::shared::CorrelatedNoise noiseFilter;
 
     sst::basic_blocks::dsp::lipol_sse<blockSizeOS, true> aegPFG_lipol;
     ModulatedValue aegPFG;
@@ -220,6 +249,46 @@ struct PolysynthVoice
     env_t aeg, feg;
     bool gated{false};
     bool active{false};
+    int activeIndex{-1}; // where the synth keeps us in its active voice list
+
+    /*
+     * The synth threads its steal candidates through these links; see
+     * ConduitPolysynth::VoiceList. The age link also holds a stolen voice on the
+     * fading list, since a voice is only ever on one of those two.
+     */
+    enum VoiceLink
+    {
+        linkAge,
+        linkReleased,
+        linkKey,
+        nVoiceLinks
+    };
+    PolysynthVoice *linkPrev[nVoiceLinks]{}, *linkNext[nVoiceLinks]{};
+    bool linked[nVoiceLinks]{};
+    uint32_t startSerial{0};
+
+    /*
+     * A stolen voice has already been ended to the host and the voice manager. It plays
+     * on under a short linear fade so the steal doesn't click, and stops when that hits 0.
+     */
+    bool stolen{false};
+    float stealGain{1.f}, stealGainStep{0.f};
+
+    /*
+     * Once released, a voice whose output peak has stayed under the synth's
+     * releaseSilenceFloor for silenceHoldSeconds is silenced, which ends it like the
+     * envelope finishing would.
+     */
+    static constexpr float silenceHoldSeconds{0.05f};
+    int silentBlocks{0}, silentBlocksToEnd{1};
+    bool silenced{false};
+    float outputPeak() const;
+    void beginStealFade(float seconds)
+    {
+        stolen = true;
+        stealGain = 1.f;
+        stealGainStep = 1.f / std::max(1.f, seconds * samplerate);
+    }
 
     using lfo_t = sst::basic_blocks::modulators::SimpleLFO<PolysynthVoice, blockSizeOS>;
     std::array<lfo_t, 2> lfos;
@@ -229,17 +298,50 @@ struct PolysynthVoice
         ModulatedValue rate, deform, amplitude;
     } lfoData[2];
 
-    void processBlock();
+    /*
+     * A voice block is rendered in stages by ConduitPolysynth::renderVoiceRange. It steps
+     * the modulators of all its voices and runs the mod matrix across them, then calls the
+     * three stages separately so that two voices with an identical filter setup can share
+     * the SIMD lanes of the filter stage with processBlockFiltersPaired.
+     */
+    void processModulators();
+    void processBlockPreFilter();
+    void processBlockFilters();
+    void processBlockPostFilter();
+
+    bool canShareFilterLanesWith(const PolysynthVoice &other) const;
+    static void processBlockFiltersPaired(PolysynthVoice &a, PolysynthVoice &b);
 
     float outputOS alignas(16)[2][blockSizeOS];
 
     void start(int16_t port, int16_t channel, int16_t key, int32_t noteid, double velocity);
     void release();
 
-    float baseFrequencyByMidiKey[128];
     void recalcPitch();
     void recalcFilter();
 
+    /*
+     * recalcPitch and recalcFilter run every block but only redo their maths when an input
+     * has moved by more than coefficientQuantum (in the input's own units, so semitones,
+     * cents or 0..1), or the synth's tuning changed. A held note with static modulation
+     * pays for a handful of compares. Anything which resets the oscillator or filter
+     * state has to invalidate, which start and setSampleRate do.
+     */
+    static constexpr float coefficientQuantum{1.f / 1024.f};
+    static int32_t quantizeInput(float v)
+    {
+        return _mm_cvtss_si32(_mm_set_ss(v * (1.f / coefficientQuantum)));
+    }
+    static constexpr int nPitchInputs{10}, nFilterInputs{4};
+    int32_t lastPitchInputs[nPitchInputs]{}, lastFilterInputs[nFilterInputs]{};
+    uint32_t pitchTuningGeneration{0};
+    bool pitchInputsValid{false}, filterInputsValid{false};
+    void invalidateCoefficientCaches()
+    {
+        pitchInputsValid = false;
+        filterInputsValid = false;
+    }
+
     void receiveNoteExpression(int expression, double value);
     void applyPolyphonicAftertouch(int8_t val) { polyphonicAT = 1.f * val / 127.f; }
     void applyChannelPressure(int8_t val)
@@ -258,7 +360,10 @@ struct PolysynthVoice
     // Sigh - fix this to a table of course
     inline float envelope_rate_linear_nowrap(float f) { return blockSizeOS * srInv * pow(2.f, -f); }
 
-    inline bool isPlaying() const { return aeg.stage < env_t::s_eoc; }
+    inline bool isPlaying() const
+    {
+        return aeg.stage < env_t::s_eoc && !silenced && !(stolen && stealGain <= 0.f);
+    }
 
     struct StereoSimperSVF // thanks to urs @ u-he and andy simper @ cytomic
     {
@@ -284,7 +389,8 @@ struct PolysynthVoice
 
         void init();
     } svfImpl;
-    std::function<__m128(StereoSimperSVF &, __m128)> svfFilterOp;
+    // the SVF mode slot filter kernels use when the SVF is off
+    static constexpr int svfBypass{StereoSimperSVF::ALL + 1};
 
     sst::waveshapers::QuadWaveshaperPtr wsPtr{nullptr};
     sst::waveshapers::QuadWaveshaperState wsState;
@@ -294,23 +400,75 @@ struct PolysynthVoice
     sst::filters::FilterType qfType;
     sst::filters::FilterSubType qfSubType;
 
-    float delayBufferData[4][sst::filters::utilities::MAX_FB_COMB +
-                             sst::filters::utilities::SincTable::FIRipol_N]{};
+    int poolIndex{0}; // our spot in the synth's voice pool and comb delay arena
 
-    struct ModRoutingData
+    // The state a filter block runs over; either a voice's own or a pair gathered into 4 lanes
+    struct FilterLanes
     {
-        float *source{nullptr};
-        float *via{nullptr};
-        float *target{nullptr};
-        float *depth{nullptr};
-        float range;
+        StereoSimperSVF &svf;
+        sst::filters::QuadFilterUnitState *qfs;
+        sst::filters::FilterUnitQFPtr qf;
+        sst::waveshapers::QuadWaveshaperState *wss;
+        sst::waveshapers::QuadWaveshaperPtr ws;
+        __m128 &feedback;
     };
+    struct PairedFilterState
+    {
+        StereoSimperSVF svf;
+        sst::filters::QuadFilterUnitState qfs;
+        sst::waveshapers::QuadWaveshaperState wss;
+        __m128 feedback;
 
-    std::array<ModRoutingData, 8> routings;
+        void gather(const PolysynthVoice &a, const PolysynthVoice &b);
+        void scatter(PolysynthVoice &a, PolysynthVoice &b) const;
+    };
+    template <FilterRouting R, int SVFMode, bool WS, bool LPF, typename Pack, typename Unpack>
+    static void filterLoop(FilterLanes &fl, Pack &&pack, Unpack &&unpack);
+
+    /*
+     * The filter stage of a block is one of a table of kernels, specialised on the routing,
+     * the SVF mode and whether the waveshaper and LPF are on, which start() picks once. The
+     * waveshaper and LPF algorithms themselves still come from the sst libraries as
+     * function pointers.
+     */
+    template <FilterRouting R, int SVFMode, bool WS, bool LPF>
+    static void filterKernel(PolysynthVoice &v);
+    template <FilterRouting R, int SVFMode, bool WS, bool LPF>
+    static void pairedFilterKernel(PolysynthVoice &a, PolysynthVoice &b);
+    void (*filterKernelFn)(PolysynthVoice &){nullptr};
+    void (*pairedFilterKernelFn)(PolysynthVoice &, PolysynthVoice &){nullptr};
+    void selectFilterKernel();
 
   private:
     double baseFreq{440.0};
     double srInv{1.0 / 44100.0};
 };
+
+/*
+ * The mod matrix, compiled by ConduitPolysynth::compileModProgram whenever the routing
+ * changes. Empty and unroutable rows are dropped, sources are indices into modSources,
+ * each distinct target gets an accumulator, and depth is pre-multiplied by the target's
+ * range. Every playing voice runs the one program, four voices to an SSE register.
+ */
+struct ModProgram
+{
+    static constexpr int maxOps{32};
+    // The svf and lpf cutoffs are always targets; see compileModProgram
+    static constexpr int maxTargets{maxOps + 2};
+
+    struct Op
+    {
+        uint8_t source, via, target;
+        float depth;
+    };
+    Op ops[maxOps]{};
+    int16_t targetSlots[maxTargets]{};
+    int nOps{0}, nTargets{0};
+
+    // Voices seeing a new generation clear their old targets before taking the new ones
+    uint32_t generation{1};
+
+    void evaluate(PolysynthVoice *const *vs, int n) const;
+};
 } // namespace sst::conduit::polysynth
 #endif
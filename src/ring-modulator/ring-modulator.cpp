@@ -48,8 +48,7 @@ const clap_plugin_descriptor *ConduitRingModulatorConfig::getDescription()
 }
 
 ConduitRingModulator::ConduitRingModulator(const clap_host *host)
-    : sst::conduit::shared::ClapBaseClass<ConduitRingModulator, ConduitRingModulatorConfig>(host),
-      hr_up(6, true), hr_scup(6, true), hr_down(6, true)
+    : sst::conduit::shared::ClapBaseClass<ConduitRingModulator, ConduitRingModulatorConfig>(host)
 {
     auto autoFlag = CLAP_PARAM_IS_AUTOMATABLE;
     auto steppedFlag = autoFlag | CLAP_PARAM_IS_STEPPED;
@@ -92,6 +91,9 @@ ConduitRingModulator::ConduitRingModulator(const clap_host *host)
                                     .withFlags(modFlag)
                                     .withName("Source Frequency")
                                     .withGroupName("Ring Modulator"));
+
+    paramDescriptions.push_back(
+        sst::conduit::shared::oversamplingParamDesc(pmOversampling, "Ring Modulator"));
     configureParams();
 
     attachParam(pmMixLevel, mix);
@@ -99,6 +101,7 @@ ConduitRingModulator::ConduitRingModulator(const clap_host *host)
 
     attachParam(pmAlgo, algo);
     attachParam(pmSource, src);
+    attachParam(pmOversampling, oversampling);
 
     clapJuceShim = std::make_unique<sst::clap_juce_shim::ClapJuceShim>(this);
     clapJuceShim->setResizable(true);
@@ -167,6 +170,9 @@ float diode_sim(float v)
 
 clap_process_status ConduitRingModulator::process(const clap_process *process) noexcept
 {
+    shared::rtcheck::AudioThreadScope rtScope;
+    PatchSwapScope patchSwap{*this, process};
+
     handleEventsFromUIQueue(process->out_events);
 
     if (process->audio_outputs_count <= 0)
@@ -189,101 +195,116 @@ clap_process_status ConduitRingModulator::process(const clap_process *process) n
     if (chans < 2)
         return CLAP_PROCESS_SLEEP;
 
-    auto ev = process->in_events;
-    auto sz = ev->size(ev);
-
-    // This pointer is the sentinel to our next event which we advance once an event is processed
-    const clap_event_header_t *nextEvent{nullptr};
-    uint32_t nextEventIndex{0};
-    if (sz != 0)
-    {
-        nextEvent = ev->get(ev, nextEventIndex);
-    }
-
     auto isDigital = *algo < 0.5;
 
-    for (auto i = 0U; i < process->frames_count; ++i)
+    // The digital algorithm is a plain multiply, so auto only oversamples the diode model
+    auto osLog2 = shared::oversamplingFactorLog2((int)std::round(*oversampling), sampleRate,
+                                                 !isDigital);
+    if (oversampler.setFactorLog2(osLog2))
+        sidechainOversampler.setFactorLog2(osLog2);
+    auto nOS = blockSize << osLog2;
+
+    /*
+     * Silence in is silence out for both algorithms, so once the input has been silent
+     * for longer than the block buffering and the filters take to clear we can skip the
+     * lot until it isn't.
+     */
+    auto frames = process->frames_count;
+    auto inputSilent = shared::audioBufferIsSilent(process->audio_inputs[0], frames);
+    reportTail(blockSize + oversampler.tailSamples());
+    if (tail.asleep && inputSilent && process->in_events->size(process->in_events) == 0)
     {
-        while (nextEvent && nextEvent->time == i)
-        {
-            handleInboundEvent(nextEvent);
-            nextEventIndex++;
-            if (nextEventIndex >= sz)
-                nextEvent = nullptr;
-            else
-                nextEvent = ev->get(ev, nextEventIndex);
-        }
-
-        inputBuf[0][pos] = in[0][i];
-        inputBuf[1][pos] = in[1][i];
-        sidechainBuf[0][pos] = sidechain[0][i];
-        sidechainBuf[1][pos] = sidechain[1][i];
+        for (auto c = 0U; c < ochans; ++c)
+            memset(out[c], 0, frames * sizeof(float));
+        return CLAP_PROCESS_SLEEP;
+    }
 
-        out[0][i] = outBuf[0][pos] * mix.v + inMixBuf[0][pos] * (1 - mix.v);
-        out[1][i] = outBuf[1][pos] * mix.v + inMixBuf[1][pos] * (1 - mix.v);
+    processEventSliced<blockSize>(
+        process, pos, [this](auto *evt) { handleInboundEvent(evt); },
+        [&](uint32_t start, uint32_t n, uint32_t bpos) {
+            for (auto i = 0U; i < n; ++i)
+            {
+                inputBuf[0][bpos + i] = in[0][start + i];
+                inputBuf[1][bpos + i] = in[1][start + i];
+                sidechainBuf[0][bpos + i] = sidechain[0][start + i];
+                sidechainBuf[1][bpos + i] = sidechain[1][start + i];
 
-        pos++;
+                out[0][start + i] =
+                    outBuf[0][bpos + i] * mix.v + inMixBuf[0][bpos + i] * (1 - mix.v);
+                out[1][start + i] =
+                    outBuf[1][bpos + i] * mix.v + inMixBuf[1][bpos + i] * (1 - mix.v);
 
-        if (pos == blockSize)
-        {
-            memcpy(inMixBuf, inputBuf, sizeof(inMixBuf));
-            hr_up.process_block_U2(inputBuf[0], inputBuf[1], inputOS[0], inputOS[1], blockSizeOS);
+                processLags();
+            }
 
-            if ((Source)(*src) == srcInternal)
+            if (bpos + n == blockSize)
             {
-                static constexpr double mf0{8.17579891564};
-                internalSource.setRate(2.0 * M_PI * note_to_pitch_ignoring_tuning(freq.v + 69) *
-                                       mf0 * dsamplerate_inv * 0.5); // 0.5 for oversample
+                memcpy(inMixBuf, inputBuf, sizeof(inMixBuf));
+                oversampler.upsample(inputBuf[0], inputBuf[1], inputOS[0], inputOS[1],
+                                     blockSize);
+                // the diode model is voiced for the input at half level
+                for (int i = 0; i < nOS; i += blockSize)
+                    mech::scale_by<blockSize>(0.5, inputOS[0] + i, inputOS[1] + i);
+
+                if ((Source)(*src) == srcInternal)
+                {
+                    static constexpr double mf0{8.17579891564};
+                    internalSource.setRate(2.0 * M_PI *
+                                           note_to_pitch_ignoring_tuning(freq.v + 69) * mf0 *
+                                           dsamplerate_inv / (1 << osLog2));
 
-                for (int i = 0; i < blockSizeOS; ++i)
+                    for (int i = 0; i < nOS; ++i)
+                    {
+                        internalSource.step();
+                        sourceOS[0][i] = 2 * internalSource.u;
+                        sourceOS[1][i] = 2 * internalSource.u;
+                    }
+                }
+                else
                 {
-                    internalSource.step();
-                    sourceOS[0][i] = 2 * internalSource.u;
-                    sourceOS[1][i] = 2 * internalSource.u;
+                    sidechainOversampler.upsample(sidechainBuf[0], sidechainBuf[1], sourceOS[0],
+                                                  sourceOS[1], blockSize);
+                    for (int i = 0; i < nOS; i += blockSize)
+                        mech::scale_by<blockSize>(2, sourceOS[0] + i, sourceOS[1] + i);
                 }
-            }
-            else
-            {
-                hr_scup.process_block_U2(sidechainBuf[0], sidechainBuf[1], sourceOS[0], sourceOS[1],
-                                         blockSizeOS);
-                mech::scale_by<blockSizeOS>(4, sourceOS[0], sourceOS[1]);
-            }
 
-            if (isDigital)
-            {
-                mech::mul_block<blockSizeOS>(inputOS[0], sourceOS[0]);
-                mech::mul_block<blockSizeOS>(inputOS[1], sourceOS[1]);
-            }
-            else
-            {
-                for (int c = 0; c < 2; ++c)
+                if (isDigital)
                 {
-                    for (int s = 0; s < blockSizeOS; ++s)
+                    for (int i = 0; i < nOS; i += blockSize)
                     {
-                        auto vin = inputOS[c][s];
-                        auto vc = sourceOS[c][s];
-                        auto A = 0.5 * vin + vc;
-                        auto B = vc - 0.5 * vin;
-
-                        auto dPA = diode_sim(A);
-                        auto dMA = diode_sim(-A);
-                        auto dPB = diode_sim(B);
-                        auto dMB = diode_sim(-B);
-
-                        auto res = dPA + dMA - dPB - dMB;
-
-                        inputOS[c][s] = res;
+                        mech::mul_block<blockSize>(inputOS[0] + i, sourceOS[0] + i);
+                        mech::mul_block<blockSize>(inputOS[1] + i, sourceOS[1] + i);
+                    }
+                }
+                else
+                {
+                    for (int c = 0; c < 2; ++c)
+                    {
+                        for (int s = 0; s < nOS; ++s)
+                        {
+                            auto vin = inputOS[c][s];
+                            auto vc = sourceOS[c][s];
+                            auto A = 0.5 * vin + vc;
+                            auto B = vc - 0.5 * vin;
+
+                            auto dPA = diode_sim(A);
+                            auto dMA = diode_sim(-A);
+                            auto dPB = diode_sim(B);
+                            auto dMB = diode_sim(-B);
+
+                            auto res = dPA + dMA - dPB - dMB;
+
+                            inputOS[c][s] = res;
+                        }
                     }
                 }
-            }
 
-            hr_down.process_block_D2(inputOS[0], inputOS[1], blockSizeOS, outBuf[0], outBuf[1]);
-            pos = 0;
-        }
+                oversampler.downsample(inputOS[0], inputOS[1], outBuf[0], outBuf[1], nOS);
+            }
+        });
 
-        processLags();
-    }
-    return CLAP_PROCESS_CONTINUE;
+    tail.update(inputSilent, true, frames, tailSamples);
+    return tail.asleep ? CLAP_PROCESS_SLEEP : CLAP_PROCESS_CONTINUE;
 }
 
 void ConduitRingModulator::handleInboundEvent(const clap_event_header_t *evt)
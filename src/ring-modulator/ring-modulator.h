@@ -31,14 +31,13 @@
 #include <memory>
 #include "sst/basic-blocks/params/ParamMetadata.h"
 #include "sst/basic-blocks/dsp/QuadratureOscillators.h"
-#include "sst/filters/HalfRateFilter.h"
-
 #include "conduit-shared/clap-base-class.h"
+#include "conduit-shared/oversampling.h"
 
 namespace sst::conduit::ring_modulator
 {
 
-static constexpr int nParams = 4;
+static constexpr int nParams = 5;
 
 struct ConduitRingModulatorConfig
 {
@@ -75,7 +74,9 @@ struct ConduitRingModulator
         pmSource = 712,
         pmInternalSourceFrequency = 1524,
 
-        pmAlgo = 17
+        pmAlgo = 17,
+
+        pmOversampling = 308
     };
 
     enum Algos : uint32_t
@@ -121,6 +122,7 @@ struct ConduitRingModulator
   protected:
     bool implementsLatency() const noexcept override { return true; }
     uint32_t latencyGet() const noexcept override { return blockSize; }
+    bool implementsTail() const noexcept override { return true; }
 
   public:
     typedef std::unordered_map<int, int> PatchPluginExtension;
@@ -129,14 +131,17 @@ struct ConduitRingModulator
     std::unique_ptr<juce::Component> createEditor() override;
     std::atomic<bool> refreshUIValues{false};
 
-    sst::filters::HalfRate::HalfRateFilter hr_up, hr_scup, hr_down;
     sst::basic_blocks::dsp::QuadratureOscillator<float> internalSource;
 
-    static constexpr int blockSize{4}, blockSizeOS{blockSize << 1};
+    static constexpr int blockSize{4},
+        maxBlockOS{blockSize * sst::conduit::shared::maxOversampling};
+    // the sidechain path only uses the upsampling half of its oversampler
+    sst::conduit::shared::Oversampler<maxBlockOS> oversampler, sidechainOversampler;
+
     float inputBuf alignas(16)[2][blockSize];
-    float inputOS alignas(16)[2][blockSizeOS];
+    float inputOS alignas(16)[2][maxBlockOS];
     float sidechainBuf alignas(16)[2][blockSize];
-    float sourceOS alignas(16)[2][blockSizeOS];
+    float sourceOS alignas(16)[2][maxBlockOS];
 
     float outBuf[2][blockSize]{};
     float inMixBuf[2][blockSize]{};
@@ -145,7 +150,7 @@ struct ConduitRingModulator
 
     lag_t mix, freq;
 
-    float *algo, *src;
+    float *algo, *src, *oversampling;
 };
 } // namespace sst::conduit::ring_modulator
 